@@ -28,6 +28,9 @@ while [ "$1" != "" ]; do
     -di | --disable-info-output)
         CMAKE_ARG="$CMAKE_ARG -DDISABLE_INFO_OUTPUT=ON"
         ;;
+    -fs | --fork-server)
+        CMAKE_ARG="$CMAKE_ARG -DFORK_SERVER=ON"
+        ;;
     *)
         echo "Invalid argument $1"
         exit
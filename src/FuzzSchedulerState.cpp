@@ -1,6 +1,8 @@
 #include "FuzzSchedulerState.hpp"
 #include "UI.hpp"
+#include "emit.hpp"
 #include "log.hpp"
+#include <algorithm>
 #include <cmath>
 
 using namespace FuzzingAST;
@@ -47,3 +49,106 @@ size_t FuzzingAST::FuzzSchedulerState::execFailureThreshold() const {
     double base = std::log2(static_cast<double>(newEdgeCnt) + 4.0);
     return static_cast<size_t>(std::clamp(base * 50.0, 100.0, 2000.0));
 }
+
+static size_t entryCost(const ASTData &data) {
+    return data.ast.declarations.size() + data.ast.expressions.size();
+}
+
+static constexpr size_t NONE = SIZE_MAX;
+
+bool FuzzingAST::FuzzSchedulerState::rate(size_t i) {
+    const auto &edges = corpus[i].edges;
+    if (!edges.empty() && edges.back() >= topRated_.size())
+        topRated_.resize(edges.back() + 1, NONE);
+    bool took = false;
+    for (uint32_t edge : edges) {
+        size_t &top = topRated_[edge];
+        if (top != i &&
+            (top == NONE || entryCost(corpus[i]) < entryCost(corpus[top]))) {
+            top = i;
+            took = true;
+        }
+    }
+    return took;
+}
+
+void FuzzingAST::FuzzSchedulerState::rebuildTopRated() {
+    topRated_.clear();
+    for (size_t i = 0; i < corpus.size(); ++i)
+        rate(i);
+    topRatedStale_ = false;
+}
+
+bool FuzzingAST::FuzzSchedulerState::admit(size_t idx,
+                                           std::vector<uint32_t> edges) {
+    if (topRatedStale_)
+        rebuildTopRated();
+    auto &entry = corpus[idx];
+    if (entry.edges.empty()) {
+        entry.edges = std::move(edges);
+    } else {
+        // both sorted, the entry only ever gains edges so the index can't
+        // point at it for one it lost
+        std::vector<uint32_t> merged;
+        merged.reserve(entry.edges.size() + edges.size());
+        std::ranges::set_union(entry.edges, edges, std::back_inserter(merged));
+        entry.edges = std::move(merged);
+    }
+    return rate(idx);
+}
+
+void FuzzingAST::FuzzSchedulerState::eraseEntry(size_t idx) {
+    fuzzerDropEntry(corpus.at(idx));
+    corpus.erase(corpus.begin() + idx);
+    // indices past idx shifted
+    topRatedStale_ = true;
+}
+
+void FuzzingAST::FuzzSchedulerState::cullCorpus() {
+    // from scratch, entries replaced since the last cull changed their cost
+    rebuildTopRated();
+    for (auto &entry : corpus)
+        entry.favored = false;
+    std::vector<bool> covered(topRated_.size(), false);
+    for (size_t edge = 0; edge < topRated_.size(); ++edge) {
+        if (topRated_[edge] == NONE || covered[edge])
+            continue;
+        auto &entry = corpus[topRated_[edge]];
+        entry.favored = true;
+        for (uint32_t e : entry.edges)
+            covered[e] = true;
+    }
+    if (corpus.size() > maxCorpusSize) {
+        // entries whose edges are all covered by favored ones add nothing
+        const auto removed = std::erase_if(corpus, [](ASTData &data) {
+            if (data.favored || data.edges.empty())
+                return false;
+            fuzzerDropEntry(data);
+            return true;
+        });
+        if (removed) {
+            INFO("Culled {} redundant corpus entries", removed);
+            topRatedStale_ = true;
+        }
+    }
+}
+
+size_t FuzzingAST::FuzzSchedulerState::pickFallback() {
+    cullCorpus();
+    const size_t next = policy->pick(corpus, rounds);
+    ++corpus[next].stats.picks;
+    return next;
+}
+
+void FuzzingAST::FuzzSchedulerState::recordRound(uint32_t foundEdges,
+                                                 uint64_t execNs) {
+    auto &st = corpus.at(idx).stats;
+    ++rounds;
+    ++st.rounds;
+    st.execNs += execNs;
+    if (foundEdges > 0) {
+        ++st.yieldRounds;
+        st.foundEdges += foundEdges;
+        st.lastFoundRound = rounds;
+    }
+}
@@ -2,8 +2,10 @@
 #define FUZZSCHEDULERSTATE_HPP
 
 #include "ast.hpp"
+#include "schedule.hpp"
 #include <stddef.h>
 #include <deque>
+#include <memory>
 
 namespace FuzzingAST {
 enum class MutationPhase {
@@ -25,6 +27,12 @@ class FuzzSchedulerState {
 	size_t maxDeclFailures = 5;
 	// max variables / type declarations in all scopes
 	size_t maxNumScopes = 50;
+	// culling drops redundant entries above this size
+	size_t maxCorpusSize = 1000;
+	// execution generation rounds so far
+	uint64_t rounds = 0;
+	// entry choice after a fallback, set by -schedule
+	std::unique_ptr<SchedulePolicy> policy = makeSchedulePolicy("favored");
 
 	BuiltinContext ctx;
 	FuzzSchedulerState() = default;
@@ -32,6 +40,30 @@ class FuzzSchedulerState {
 	void update(bool gotNewEdge, size_t maxNumScopes);
 
 	size_t execFailureThreshold() const;
+
+	// add the edges recorded while fuzzing entry idx to its edges, false if
+	// it isn't the smallest entry hitting any of them
+	bool admit(size_t idx, std::vector<uint32_t> edges);
+	// drop entry idx from the corpus and corpus/saved
+	void eraseEntry(size_t idx);
+	// mark the smallest entries that together cover every recorded edge
+	// (AFL's cull_queue), drops redundant ones if the corpus is too big
+	void cullCorpus();
+	// index of the next entry after a fallback, chosen by the policy
+	size_t pickFallback();
+	// account one execution generation round of the current entry
+	void recordRound(uint32_t foundEdges, uint64_t execNs);
+
+  private:
+	// make entry i the top one of the edges it hits more cheaply, true if
+	// it took any
+	bool rate(size_t i);
+	void rebuildTopRated();
+
+	// smallest entry hitting each edge, so admitting doesn't scan the
+	// corpus. Rebuilt by culling and after an entry is removed
+	std::vector<size_t> topRated_;
+	bool topRatedStale_ = false;
 };
 } // namespace FuzzingAST
 
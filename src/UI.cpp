@@ -18,6 +18,11 @@ const static std::string stage_names[] = {
 extern uint32_t newEdgeCnt;
 extern uint32_t errCnt;
 extern uint32_t corpusSize;
+extern uint64_t codeCacheHits;
+extern uint64_t codeCacheMisses;
+extern uint64_t feedbackHits;
+extern uint64_t feedbackFixes;
+extern uint64_t timeoutCnt;
 
 class RingBuffer {
   public:
@@ -131,7 +136,7 @@ static bool tuiEnabled = false;
 void FuzzingAST::TUI::update(const FuzzingAST::FuzzSchedulerState &state,
                              size_t currentASTSize) {
     static int tuiCounter = 0;
-    if (++tuiCounter % TUI_FREQ == 0)
+    if (tuiEnabled && ++tuiCounter % TUI_FREQ == 0)
         TUI::writeTUI(state, currentASTSize);
 }
 
@@ -192,7 +197,17 @@ void FuzzingAST::TUI::writeTUI(const FuzzingAST::FuzzSchedulerState &state,
                   separator(), text("ExecThresh: ") | dim,
                   text(std::to_string(state.execFailureThreshold())),
                   separator(), text("Saved Corpus Size: ") | dim,
-                  text(std::to_string(corpusSize))}),
+                  text(std::to_string(corpusSize)), separator(),
+                  text("Schedule: ") | dim, text(state.policy->name())}),
+            hbox({text("CodeCache Hits: ") | dim,
+                  text(std::to_string(codeCacheHits)), separator(),
+                  text("Misses: ") | dim,
+                  text(std::to_string(codeCacheMisses)), separator(),
+                  text("Repairs: ") | dim,
+                  text(std::to_string(feedbackFixes) + "/" +
+                       std::to_string(feedbackHits)),
+                  separator(), text("Timeouts: ") | dim,
+                  text(std::to_string(timeoutCnt))}),
             filler(),
         }) |
         flex;
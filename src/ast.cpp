@@ -56,16 +56,87 @@ TypeID FuzzingAST::resolveType(const std::string &fullname,
 
 std::optional<PropInfo>
 FuzzingAST::getPropByName(const std::string &name,
-                          const std::vector<PropInfo> &slice, bool isCallable,
+                          const PropList &slice, bool isCallable,
                           ScopeID sid) {
-    auto it = std::find_if(slice.begin(), slice.end(),
-                           [&name, isCallable, sid](const PropInfo &prop) {
-                               return prop.name == name && prop.scope <= sid &&
-                                      (isCallable == prop.isCallable);
-                           });
+    auto it = slice.findNamed(name, [isCallable, sid](const PropInfo &prop) {
+        return prop.scope <= sid && (isCallable == prop.isCallable);
+    });
     if (it != slice.end()) {
         return *it;
     }
     return std::nullopt;
 }
 
+
+static inline void hashCombine(size_t &seed, size_t h) {
+    seed ^= h + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+size_t FuzzingAST::hashNode(const ASTNode &node) {
+    size_t seed = static_cast<size_t>(node.kind);
+    hashCombine(seed, node.fields.size());
+    for (const auto &field : node.fields) {
+        hashCombine(seed, field.val.index());
+        std::visit(
+            [&seed]<typename T>(const T &v) {
+                hashCombine(seed, std::hash<T>()(v));
+            },
+            field.val);
+    }
+    return seed;
+}
+
+static void collectScopeBody(std::vector<const ASTNode *> &out,
+                             const AST &ast, ScopeID sid);
+
+static void collectDecl(std::vector<const ASTNode *> &out, const AST &ast,
+                        const ASTNode &node) {
+    out.push_back(&node);
+    if (node.kind == ASTNodeKind::Function) {
+        collectScopeBody(out, ast, node.scope);
+    } else if (node.kind == ASTNodeKind::Class) {
+        // member functions are referenced by node id after the sentinel
+        size_t idx = 1;
+        for (; idx < node.fields.size(); ++idx) {
+            if (std::holds_alternative<int64_t>(node.fields[idx].val) &&
+                std::get<int64_t>(node.fields[idx].val) == -1) {
+                ++idx;
+                break;
+            }
+        }
+        for (; idx < node.fields.size(); ++idx)
+            collectDecl(out, ast,
+                        ast.declarations[std::get<int64_t>(
+                            node.fields[idx].val)]);
+    }
+}
+
+static void collectScopeBody(std::vector<const ASTNode *> &out,
+                             const AST &ast, ScopeID sid) {
+    if (sid < 0 || static_cast<size_t>(sid) >= ast.scopes.size())
+        return;
+    const ASTScope &scope = ast.scopes[sid];
+    if (scope.globalRefID != -1)
+        out.push_back(&ast.declarations[scope.globalRefID]);
+    for (NodeID id : scope.declarations)
+        if (ast.declarations[id].kind != ASTNodeKind::Function)
+            collectDecl(out, ast, ast.declarations[id]);
+    for (NodeID id : scope.expressions)
+        out.push_back(&ast.expressions[id]);
+    if (scope.retNodeID != -1)
+        out.push_back(&ast.expressions[scope.retNodeID]);
+}
+
+size_t FuzzingAST::declarationNodes(const AST &ast,
+                                    std::vector<const ASTNode *> &out) {
+    out.clear();
+    for (NodeID id : ast.scopes[0].declarations) {
+        const auto &node = ast.declarations[id];
+        if (node.kind != ASTNodeKind::Function)
+            collectDecl(out, ast, node);
+    }
+    size_t seed = 0;
+    for (const auto *node : out)
+        hashCombine(seed, hashNode(*node));
+    return seed;
+}
@@ -1,6 +1,10 @@
 #ifndef AST_HPP
 #define AST_HPP
 
+#include "cow.hpp"
+#include "symbol.hpp"
+#include "typemap.hpp"
+#include <algorithm>
 #include <array>
 #include <optional>
 #include <random>
@@ -96,6 +100,109 @@ class PropInfo {
     };
 };
 
+// Props of one type with a name index, by-name lookups binary search the
+// sorted (symbol, position) pairs instead of comparing every name. A prop's
+// name must not change while it is in the list, replace the entry instead.
+class PropList {
+  public:
+    using value_type = PropInfo;
+    using iterator = std::vector<PropInfo>::iterator;
+    using const_iterator = std::vector<PropInfo>::const_iterator;
+
+    PropList() = default;
+    PropList(std::vector<PropInfo> props) : props_(std::move(props)) {
+        reindex();
+    }
+
+    size_t size() const { return props_.size(); }
+    bool empty() const { return props_.empty(); }
+    iterator begin() { return props_.begin(); }
+    iterator end() { return props_.end(); }
+    const_iterator begin() const { return props_.begin(); }
+    const_iterator end() const { return props_.end(); }
+    PropInfo &operator[](size_t i) { return props_[i]; }
+    const PropInfo &operator[](size_t i) const { return props_[i]; }
+    PropInfo &at(size_t i) { return props_.at(i); }
+    const PropInfo &at(size_t i) const { return props_.at(i); }
+    const std::vector<PropInfo> &props() const { return props_; }
+    // the names index follows from the props
+    bool operator==(const PropList &other) const {
+        return props_ == other.props_;
+    }
+
+    template <typename... Args> PropInfo &emplace_back(Args &&...args) {
+        auto &prop = props_.emplace_back(std::forward<Args>(args)...);
+        addName(prop.name, props_.size() - 1);
+        return prop;
+    }
+    void push_back(PropInfo prop) { emplace_back(std::move(prop)); }
+    iterator erase(const_iterator pos) {
+        auto it = props_.erase(pos);
+        reindex();
+        return it;
+    }
+    void clear() {
+        props_.clear();
+        names_.clear();
+    }
+    void swap(PropList &other) noexcept {
+        props_.swap(other.props_);
+        names_.swap(other.names_);
+    }
+
+    // first prop called `name` that satisfies pred, end() if none
+    template <typename Pred = bool (*)(const PropInfo &)>
+    const_iterator findNamed(std::string_view name,
+                             Pred pred = anyProp) const {
+        for (auto [it, last] = named(name); it != last; ++it)
+            if (pred(props_[it->second]))
+                return begin() + it->second;
+        return end();
+    }
+    template <typename Pred = bool (*)(const PropInfo &)>
+    iterator findNamed(std::string_view name, Pred pred = anyProp) {
+        const auto it = std::as_const(*this).findNamed(name, pred);
+        return begin() + (it - props_.cbegin());
+    }
+    // every prop called `name`, in list order
+    template <typename Fn> void forEachNamed(std::string_view name, Fn &&fn) {
+        for (auto [it, last] = named(name); it != last; ++it)
+            fn(props_[it->second]);
+    }
+
+  private:
+    using NameEntry = std::pair<SymbolID, uint32_t>;
+    static bool anyProp(const PropInfo &) { return true; }
+
+    std::pair<std::vector<NameEntry>::const_iterator,
+              std::vector<NameEntry>::const_iterator>
+    named(std::string_view name) const {
+        const auto sym = findSymbol(name);
+        if (sym == NO_SYMBOL)
+            return {names_.end(), names_.end()};
+        return std::equal_range(names_.begin(), names_.end(), NameEntry{sym, 0},
+                                [](const NameEntry &a, const NameEntry &b) {
+                                    return a.first < b.first;
+                                });
+    }
+    void addName(const std::string &name, size_t pos) {
+        const NameEntry entry{internSymbol(name), static_cast<uint32_t>(pos)};
+        names_.insert(
+            std::upper_bound(names_.begin(), names_.end(), entry), entry);
+    }
+    void reindex() {
+        names_.clear();
+        names_.reserve(props_.size());
+        for (size_t i = 0; i < props_.size(); ++i)
+            names_.emplace_back(internSymbol(props_[i].name),
+                                static_cast<uint32_t>(i));
+        std::sort(names_.begin(), names_.end());
+    }
+
+    std::vector<PropInfo> props_;
+    std::vector<NameEntry> names_; // sorted by symbol, then position
+};
+
 class ASTData; // forward declaration
 class AST;
 
@@ -122,10 +229,8 @@ class PropKey {
 
 class BuiltinContext {
   public:
-    std::unordered_map<TypeID, std::vector<PropInfo>> builtinsProps = {};
-    std::unordered_map<ModuleID,
-                       std::unordered_map<TypeID, std::vector<PropInfo>>>
-        modulesProps = {};
+    TypeMap<PropList> builtinsProps = {};
+    TypeMap<TypeMap<PropList>> modulesProps = {};
     std::vector<std::string> types = {};
     size_t builtinTypesCnt = 0;
     std::vector<std::vector<std::vector<TypeID>>> ops = {};
@@ -141,14 +246,13 @@ class BuiltinContext {
         9, 1}; // 9:1 non-const and const
                // --- variable provider ---
   public:
-    // Build index for all scopes, merging parent scope and initializing
-    // distributions
-    void updateVars(const AST &ast);
-    void updateFuncs(const AST &ast);
-    inline void update(const AST &ast) {
-        updateVars(ast);
-        updateFuncs(ast);
-    }
+    // Bring the sampling index in line with ast. Builtin and module props
+    // are indexed once and shared by all scopes, of classProps only what
+    // changed since the last call is re-indexed. Changes to builtinsProps
+    // need invalidateIndex() first.
+    void update(const AST &ast);
+    // force a full rebuild on the next update()
+    void invalidateIndex() { indexValid_ = false; }
 
     // Pick a random type available in given scope (fallback to 0)
     TypeID pickRandomType(ScopeID scopeID);
@@ -168,25 +272,72 @@ class BuiltinContext {
     PropKey pickRandomMethod(TypeID tid);
 
   private:
-    std::vector<std::unordered_map<TypeID, std::vector<PropKey>>> constIndex_;
-    std::vector<std::unordered_map<TypeID, std::vector<PropKey>>> mutableIndex_;
-
-    std::vector<std::vector<TypeID>> typeList_;
-    std::vector<std::uniform_int_distribution<size_t>> typeDist_;
-    std::vector<std::unordered_map<
-        TypeID, std::array<std::uniform_int_distribution<size_t>, 2>>>
-        varDist_;
-
-    std::vector<std::vector<PropKey>> funcList_;
-    std::vector<std::uniform_int_distribution<size_t>> funcDist_;
-    std::vector<size_t> funcCnts_;
-    std::unordered_map<TypeID, std::uniform_int_distribution<size_t>>
-        methodDist_;
+    // keys of one source of props, shared by every scope that sees them
+    struct SharedLayer {
+        TypeMap<std::vector<PropKey>> constVars;
+        TypeMap<std::vector<PropKey>> mutableVars;
+        std::vector<PropKey> funcs;
+    };
+    // classProps keys, any one can be swapped out with the last in O(1)
+    struct Bucket {
+        std::vector<PropKey> keys;
+        std::unordered_map<uint64_t, size_t> pos;
+        void add(const PropKey &key);
+        void remove(TypeID tid, size_t idx);
+    };
+    // what a scope sees on top of the shared layers
+    struct ScopeIndex {
+        TypeMap<Bucket> constVars;
+        TypeMap<Bucket> mutableVars;
+        Bucket funcs;
+        // pickable types the shared layers have no mutable vars of
+        std::vector<TypeID> extraTypes;
+    };
+    // the part of a classProps entry the index depends on
+    struct IndexedProp {
+        TypeID type;
+        ScopeID scope;
+        bool isConst;
+        bool isCallable;
+        bool operator==(const IndexedProp &) const = default;
+    };
+
+    SharedLayer buildLayer(ModuleID mid,
+                           const TypeMap<PropList> &props) const;
+    void useModules(const std::unordered_set<ModuleID> &modules);
+    void rebuildUserIndex(const AST &ast);
+    bool userIndexStale(const AST &ast) const;
+    void indexProp(ScopeIndex &s, TypeID tid, size_t idx,
+                   const IndexedProp &prop, bool add);
+    void indexProp(TypeID tid, size_t idx, const IndexedProp &prop, bool add);
+    bool interactable(TypeID type) const;
+    size_t sharedCount(bool isConst, TypeID type) const;
+    void refreshSharedTypes();
+    void refreshType(ScopeIndex &s, TypeID type);
+    void refreshMethods(TypeID tid, size_t classSize);
+#ifdef INDEX_CONSISTENCY_CHECK
+    void checkIndex(const AST &ast) const;
+#endif
+
+    bool indexValid_ = false;
+    SharedLayer builtinLayer_;
+    TypeMap<SharedLayer> moduleLayers_;
+    // builtin layer first, then the imported modules, points into this
+    // object, a copy has to invalidateIndex() before use
+    std::vector<const SharedLayer *> shared_;
+    std::vector<TypeID> sharedTypes_;
+    std::unordered_set<ModuleID> indexedModules_;
+
+    std::vector<ScopeIndex> scopes_;
+    // classProps as of the last update, to diff the next AST against
+    TypeMap<std::vector<IndexedProp>> indexedProps_;
+    TypeMap<std::uniform_int_distribution<size_t>> methodDist_;
 };
 
 class ASTNodeValue {
   public:
-    std::variant<std::string, int64_t, bool, double> val;
+    std::variant<Symbol, int64_t, bool, double, Literal> val;
+    bool operator==(const ASTNodeValue &) const = default;
 };
 
 class ASTNode {
@@ -202,6 +353,7 @@ class ASTNode {
      */
     std::vector<ASTNodeValue> fields = {};
     ScopeID scope = -1;
+    bool operator==(const ASTNode &) const = default;
 };
 
 class ASTScope {
@@ -221,24 +373,45 @@ class ASTScope {
 class AST {
   public:
     std::string nameCnt = "aaa"; // try to avoid keyword, like `as`
-    std::vector<ASTScope> scopes = {};
-    std::vector<ASTNode> declarations = {};
-    std::vector<ASTNode> expressions = {};
+    // copy-on-write chunks, copying an AST shares everything until a chunk
+    // is written to, scopes are chunked finer since they are larger
+    CowVector<ASTScope, 2> scopes = {};
+    CowVector<ASTNode> declarations = {};
+    CowVector<ASTNode> expressions = {};
     // variables treated as parentType = -1(no parent), ModuleID = -1(no module)
-    std::vector<PropKey> variables = {};
+    CowVector<PropKey> variables = {};
     std::unordered_set<ModuleID> importedModules = {};
     // we don't do normal function in fuzzing,
     // bc it is very unlikely to trigger bugs
     // std::vector<PropInfo> functions;
-    std::unordered_map<TypeID, std::vector<PropInfo>> classProps;
+    TypeMap<PropList> classProps;
 
     // generate main block
     AST() : scopes({ASTScope()}) {}
 };
 
+// scheduling statistics of a corpus entry
+struct EntryStats {
+    uint32_t picks = 0;        // times chosen after a fallback
+    uint32_t rounds = 0;       // execution generation rounds
+    uint32_t yieldRounds = 0;  // rounds that found new edges
+    uint64_t foundEdges = 0;   // new (edge, bucket) pairs found
+    uint64_t execNs = 0;       // time spent in generation rounds
+    uint64_t lastFoundRound = 0; // scheduler round of the last find
+};
+
 class ASTData {
   public:
     AST ast;
+    // sorted ids of the edges hit while the entry was fuzzed, empty if it
+    // was loaded or synced and not evaluated yet
+    std::vector<uint32_t> edges;
+    bool favored = false;
+    EntryStats stats;
+    // file mirroring the entry in corpus/saved, empty if not saved
+    std::string savedPath;
+    // changed since savedPath was written
+    bool unsaved = false;
 };
 
 class ExecutionContext {
@@ -246,6 +419,15 @@ class ExecutionContext {
     virtual ~ExecutionContext() = default;
     virtual void *getContext() = 0;
     virtual void releasePtr() = 0;
+    // remember the current state as the last known good one
+    virtual void checkpoint() {}
+    // roll back to the last checkpoint, false if the target can't. Only the
+    // bindings of the globals are rolled back, an object the interrupted line
+    // changed in place keeps the change. The driver replays the history of a
+    // restored stream before it keeps the lines run after the restore
+    virtual bool restore() { return false; }
+    // restore brings back the exact state, not only the global bindings
+    virtual bool exactRestore() const { return false; }
 };
 
 const std::string &getTypeName(TypeID tid, const AST &ast,
@@ -253,9 +435,14 @@ const std::string &getTypeName(TypeID tid, const AST &ast,
 TypeID resolveType(const std::string &fullname, const BuiltinContext &ctx,
                    const AST &ast, ScopeID sid);
 std::optional<PropInfo> getPropByName(const std::string &name,
-                                      const std::vector<PropInfo> &slice,
+                                      const PropList &slice,
                                       bool isCallable, ScopeID sid);
 void initPrimitiveTypes(BuiltinContext &ctx);
+// structural hashes, used to look up compiled code
+size_t hashNode(const ASTNode &node);
+// every node rendered for the scope-0 declaration prefix, in order, returns
+// their combined hashNode
+size_t declarationNodes(const AST &ast, std::vector<const ASTNode *> &out);
 inline const PropInfo &unfoldKey(const PropKey &key, const AST &ast,
                                  const BuiltinContext &ctx) {
     if (key.moduleID == BUILTIN_MODULE_ID)
@@ -0,0 +1,353 @@
+#include "binser.hpp"
+#include "serialization.hpp"
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace FuzzingAST;
+using namespace FuzzingAST::BinSer;
+
+namespace {
+class Writer {
+  public:
+    explicit Writer(std::string &out) : out_(out) {}
+
+    void u(uint64_t v) {
+        while (v >= 0x80) {
+            out_.push_back(static_cast<char>(v | 0x80));
+            v >>= 7;
+        }
+        out_.push_back(static_cast<char>(v));
+    }
+    void i(int64_t v) {
+        u((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+    }
+    void b(bool v) { out_.push_back(v ? 1 : 0); }
+    void d(double v) {
+        char buf[sizeof(v)];
+        std::memcpy(buf, &v, sizeof(v));
+        out_.append(buf, sizeof(v));
+    }
+    void str(const std::string &s) {
+        auto [it, inserted] = strings_.try_emplace(s, strings_.size());
+        if (inserted) {
+            u((s.size() << 1) | 1);
+            out_.append(s);
+        } else {
+            u(static_cast<uint64_t>(it->second) << 1);
+        }
+    }
+    void symbol(const Symbol &s) {
+        // the string table holds views, interned names are stable
+        if (!s.dotted())
+            return str(s.name());
+        str(dotted_.emplace_back(s.str()));
+    }
+    template <typename V, typename F> void vec(const V &v, F &&each) {
+        u(v.size());
+        for (const auto &x : v)
+            each(x);
+    }
+    void ints(const std::vector<int> &v) {
+        vec(v, [this](int x) { i(x); });
+    }
+
+    void node(const ASTNode &n) {
+        u(static_cast<uint64_t>(n.kind));
+        i(n.scope);
+        u(n.fields.size());
+        for (const auto &f : n.fields) {
+            u(f.val.index());
+            switch (f.val.index()) {
+            case 0:
+                symbol(std::get<Symbol>(f.val));
+                break;
+            case 1:
+                i(std::get<int64_t>(f.val));
+                break;
+            case 2:
+                b(std::get<bool>(f.val));
+                break;
+            case 3:
+                d(std::get<double>(f.val));
+                break;
+            case 4:
+                str(std::get<Literal>(f.val).str());
+                break;
+            }
+        }
+    }
+    void scope(const ASTScope &s) {
+        i(s.parent);
+        i(s.retType);
+        i(s.paramCnt);
+        i(s.retNodeID);
+        i(s.globalRefID);
+        ints(s.declarations);
+        ints(s.expressions);
+        vec(s.types, [this](const std::string &t) { str(t); });
+        ints(s.inheritedTypes);
+        ints(s.variables);
+    }
+    void prop(const PropInfo &p) {
+        i(p.type);
+        i(p.scope);
+        str(p.name);
+        b(p.isConst);
+        b(p.isCallable);
+        b(p.isArg);
+        ints(p.funcSig.paramTypes);
+        i(p.funcSig.selfType);
+        i(p.funcSig.returnType);
+    }
+    void ast(const AST &a) {
+        str(a.nameCnt);
+        vec(a.scopes, [this](const ASTScope &s) { scope(s); });
+        vec(a.declarations, [this](const ASTNode &n) { node(n); });
+        vec(a.expressions, [this](const ASTNode &n) { node(n); });
+        vec(a.variables, [this](const PropKey &k) {
+            i(k.moduleID);
+            u(k.idx);
+            i(k.parentType);
+        });
+        u(a.importedModules.size());
+        for (ModuleID m : a.importedModules)
+            i(m);
+        u(a.classProps.size());
+        for (const auto &[tid, props] : a.classProps) {
+            i(tid);
+            vec(props, [this](const PropInfo &p) { prop(p); });
+        }
+    }
+
+  private:
+    std::string &out_;
+    std::unordered_map<std::string_view, uint32_t> strings_;
+    std::deque<std::string> dotted_;
+};
+
+class Reader {
+  public:
+    Reader(std::string_view in, size_t pos, size_t end)
+        : in_(in), pos_(pos), end_(end) {}
+
+    size_t pos() const { return pos_; }
+
+    uint8_t byte() {
+        if (pos_ >= end_)
+            throw std::runtime_error("truncated binary AST");
+        return static_cast<uint8_t>(in_[pos_++]);
+    }
+    uint64_t u() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const uint8_t c = byte();
+            v |= static_cast<uint64_t>(c & 0x7f) << shift;
+            if (!(c & 0x80))
+                return v;
+        }
+        throw std::runtime_error("malformed varint in binary AST");
+    }
+    int64_t i() {
+        const uint64_t v = u();
+        return static_cast<int64_t>((v >> 1) ^ (~(v & 1) + 1));
+    }
+    bool b() { return byte() != 0; }
+    double d() {
+        if (end_ - pos_ < sizeof(double))
+            throw std::runtime_error("truncated binary AST");
+        double v;
+        std::memcpy(&v, in_.data() + pos_, sizeof(v));
+        pos_ += sizeof(v);
+        return v;
+    }
+    std::string str() {
+        const uint64_t v = u();
+        if (!(v & 1)) {
+            if ((v >> 1) >= strings_.size())
+                throw std::runtime_error("bad string index in binary AST");
+            return std::string(strings_[v >> 1]);
+        }
+        const size_t len = v >> 1;
+        if (end_ - pos_ < len)
+            throw std::runtime_error("truncated binary AST");
+        strings_.push_back(in_.substr(pos_, len));
+        pos_ += len;
+        return std::string(strings_.back());
+    }
+    template <typename T, typename F> std::vector<T> vec(F &&each) {
+        const uint64_t n = u();
+        if (n > end_ - pos_) // every element takes at least one byte
+            throw std::runtime_error("bad length in binary AST");
+        std::vector<T> v;
+        v.reserve(n);
+        for (uint64_t k = 0; k < n; ++k)
+            v.push_back(each());
+        return v;
+    }
+    std::vector<int> ints() {
+        return vec<int>([this] { return static_cast<int>(i()); });
+    }
+
+    ASTNode node() {
+        ASTNode n;
+        n.kind = static_cast<ASTNodeKind>(u());
+        n.scope = static_cast<ScopeID>(i());
+        n.fields = vec<ASTNodeValue>([this] {
+            ASTNodeValue f;
+            switch (u()) {
+            case 0:
+                f.val = Symbol(str());
+                break;
+            case 1:
+                f.val = i();
+                break;
+            case 2:
+                f.val = b();
+                break;
+            case 3:
+                f.val = d();
+                break;
+            case 4:
+                f.val = Literal(str());
+                break;
+            default:
+                throw std::runtime_error("Invalid ASTNodeValue type");
+            }
+            return f;
+        });
+        return n;
+    }
+    ASTScope scope() {
+        ASTScope s;
+        s.parent = static_cast<ScopeID>(i());
+        s.retType = static_cast<TypeID>(i());
+        s.paramCnt = static_cast<int>(i());
+        s.retNodeID = static_cast<NodeID>(i());
+        s.globalRefID = static_cast<NodeID>(i());
+        s.declarations = ints();
+        s.expressions = ints();
+        s.types = vec<std::string>([this] { return str(); });
+        s.inheritedTypes = ints();
+        s.variables = ints();
+        return s;
+    }
+    PropInfo prop() {
+        PropInfo p;
+        p.type = static_cast<TypeID>(i());
+        p.scope = static_cast<ScopeID>(i());
+        p.name = str();
+        p.isConst = b();
+        p.isCallable = b();
+        p.isArg = b();
+        p.funcSig.paramTypes = ints();
+        p.funcSig.selfType = static_cast<TypeID>(i());
+        p.funcSig.returnType = static_cast<TypeID>(i());
+        return p;
+    }
+    AST ast() {
+        AST a;
+        a.nameCnt = str();
+        a.scopes = vec<ASTScope>([this] { return scope(); });
+        a.declarations = vec<ASTNode>([this] { return node(); });
+        a.expressions = vec<ASTNode>([this] { return node(); });
+        a.variables = vec<PropKey>([this] {
+            PropKey k;
+            k.moduleID = static_cast<ModuleID>(i());
+            k.idx = u();
+            k.parentType = static_cast<TypeID>(i());
+            return k;
+        });
+        for (uint64_t n = u(); n > 0; --n)
+            a.importedModules.insert(static_cast<ModuleID>(i()));
+        for (uint64_t n = u(); n > 0; --n) {
+            const auto tid = static_cast<TypeID>(i());
+            a.classProps[tid] = vec<PropInfo>([this] { return prop(); });
+        }
+        return a;
+    }
+
+  private:
+    std::string_view in_;
+    size_t pos_;
+    size_t end_;
+    std::vector<std::string_view> strings_;
+};
+
+template <typename T>
+void encode(std::string &out, RecordKind kind, const T &value) {
+    // payload goes to a scratch buffer first to learn its length
+    static std::string scratch;
+    scratch.clear();
+    Writer payload(scratch);
+    if constexpr (std::is_same_v<T, AST>)
+        payload.ast(value);
+    else
+        payload.node(value);
+    out.push_back(static_cast<char>(kind));
+    Writer(out).u(scratch.size());
+    out.append(scratch);
+}
+
+// checks the record header and returns a reader limited to its payload
+Reader openRecord(std::string_view in, size_t &pos, RecordKind kind) {
+    Reader header(in, pos, in.size());
+    if (static_cast<RecordKind>(header.byte()) != kind)
+        throw std::runtime_error("unexpected record kind in binary AST");
+    const uint64_t len = header.u();
+    if (len > in.size() - header.pos())
+        throw std::runtime_error("truncated binary AST");
+    pos = header.pos() + len;
+    return Reader(in, header.pos(), pos);
+}
+} // namespace
+
+void FuzzingAST::BinSer::encodeRecord(std::string &out, const AST &ast) {
+    encode(out, RecordKind::AST, ast);
+}
+
+void FuzzingAST::BinSer::encodeRecord(std::string &out, const ASTNode &node) {
+    encode(out, RecordKind::Node, node);
+}
+
+std::string FuzzingAST::BinSer::encodeFile(const AST &ast) {
+    std::string out(MAGIC);
+    encodeRecord(out, ast);
+    return out;
+}
+
+RecordKind FuzzingAST::BinSer::peekRecord(std::string_view in, size_t pos) {
+    if (pos >= in.size())
+        throw std::runtime_error("truncated binary AST");
+    return static_cast<RecordKind>(in[pos]);
+}
+
+AST FuzzingAST::BinSer::decodeAST(std::string_view in, size_t &pos) {
+    return openRecord(in, pos, RecordKind::AST).ast();
+}
+
+ASTNode FuzzingAST::BinSer::decodeNode(std::string_view in, size_t &pos) {
+    return openRecord(in, pos, RecordKind::Node).node();
+}
+
+bool FuzzingAST::BinSer::isBinary(std::string_view content) {
+    return content.starts_with(MAGIC);
+}
+
+AST FuzzingAST::BinSer::parseAST(std::string_view content) {
+    if (isBinary(content)) {
+        size_t pos = MAGIC.size();
+        AST ast = decodeAST(content, pos);
+        std::vector<NodeID> lines;
+        while (pos < content.size() &&
+               peekRecord(content, pos) == RecordKind::Node) {
+            lines.push_back(ast.expressions.size());
+            ast.expressions.push_back(decodeNode(content, pos));
+        }
+        if (!lines.empty())
+            ast.scopes[0].expressions = std::move(lines);
+        return ast;
+    }
+    return nlohmann::json::parse(content).get<AST>();
+}
@@ -0,0 +1,35 @@
+#ifndef BINSER_HPP
+#define BINSER_HPP
+
+#include "ast.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Compact binary format for ASTs, used on the hot path (crash backups, corpus
+// queue, saved corpus). A file is MAGIC followed by records; a record is
+// kind byte + varint payload length + payload. Integers are (zigzag) varints
+// and every record interns its strings: the first occurrence is written
+// inline, later ones as an index. JSON stays the export format.
+namespace FuzzingAST::BinSer {
+constexpr std::string_view MAGIC = "GFB1";
+enum class RecordKind : uint8_t { AST = 1, Node = 2 };
+
+void encodeRecord(std::string &out, const AST &ast);
+void encodeRecord(std::string &out, const ASTNode &node);
+// MAGIC + one AST record
+std::string encodeFile(const AST &ast);
+
+// kind of the record at pos, throws std::runtime_error if truncated
+RecordKind peekRecord(std::string_view in, size_t pos);
+// decode the record at pos and move pos past it
+AST decodeAST(std::string_view in, size_t &pos);
+ASTNode decodeNode(std::string_view in, size_t &pos);
+
+bool isBinary(std::string_view content);
+// binary file or JSON document; Node records following the AST record (crash
+// journal) become its scope-0 expressions
+AST parseAST(std::string_view content);
+} // namespace FuzzingAST::BinSer
+
+#endif // BINSER_HPP
@@ -0,0 +1,63 @@
+#ifndef CODEBUF_HPP
+#define CODEBUF_HPP
+
+#include <charconv>
+#include <concepts>
+#include <string>
+#include <string_view>
+
+namespace FuzzingAST {
+// append-only text buffer for the dumpers, clear() keeps the capacity so a
+// buffer reused across lines stops allocating once it has grown
+class CodeBuffer {
+  public:
+    explicit CodeBuffer(size_t reserve = 4096) { buf_.reserve(reserve); }
+
+    void clear() { buf_.clear(); }
+    bool empty() const { return buf_.empty(); }
+    size_t size() const { return buf_.size(); }
+    const std::string &str() const { return buf_; }
+    const char *c_str() const { return buf_.c_str(); }
+
+    CodeBuffer &indent(int level) {
+        buf_.append(static_cast<size_t>(level) * 4, ' ');
+        return *this;
+    }
+
+    CodeBuffer &operator<<(std::string_view s) {
+        buf_.append(s);
+        return *this;
+    }
+    CodeBuffer &operator<<(const std::string &s) {
+        return *this << std::string_view(s);
+    }
+    CodeBuffer &operator<<(const char *s) {
+        return *this << std::string_view(s);
+    }
+    CodeBuffer &operator<<(char c) {
+        buf_.push_back(c);
+        return *this;
+    }
+    template <std::integral T>
+        requires(!std::same_as<T, char> && !std::same_as<T, bool>)
+    CodeBuffer &operator<<(T v) {
+        char tmp[24];
+        const auto res = std::to_chars(tmp, tmp + sizeof(tmp), v);
+        buf_.append(tmp, res.ptr);
+        return *this;
+    }
+    // same text as an ostream with default flags (%g, precision 6)
+    CodeBuffer &operator<<(double v) {
+        char tmp[32];
+        const auto res = std::to_chars(tmp, tmp + sizeof(tmp), v,
+                                       std::chars_format::general, 6);
+        buf_.append(tmp, res.ptr);
+        return *this;
+    }
+
+  private:
+    std::string buf_;
+};
+} // namespace FuzzingAST
+
+#endif // CODEBUF_HPP
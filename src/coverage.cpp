@@ -0,0 +1,113 @@
+#include "coverage.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <utility>
+
+using namespace FuzzingAST;
+
+// slot 0 collects guards beyond the map size and is never reported
+static uint8_t dummyTrace[8];
+uint8_t *FuzzingAST::traceMap = dummyTrace;
+static uint8_t *seenBuckets = nullptr;
+static uint32_t numGuards = 0;
+// trace bytes to reset and scan, in 64-bit words
+static size_t traceWords = 0;
+// edges hit since the last takeEdgeRecord, as bitset and as list
+static std::vector<uint64_t> recordBits;
+static std::vector<uint32_t> recordedEdges;
+
+static constexpr std::array<uint8_t, 256> COUNT_CLASS = [] {
+    std::array<uint8_t, 256> table{};
+    for (size_t i = 1; i < table.size(); ++i) {
+        if (i <= 3)
+            table[i] = 1 << (i - 1);
+        else if (i <= 7)
+            table[i] = 1 << 3;
+        else if (i <= 15)
+            table[i] = 1 << 4;
+        else if (i <= 31)
+            table[i] = 1 << 5;
+        else if (i <= 127)
+            table[i] = 1 << 6;
+        else
+            table[i] = 1 << 7;
+    }
+    return table;
+}();
+
+static uint8_t *mapCoverage(int shareFlag) {
+    void *map = mmap(nullptr, COVERAGE_MAP_SIZE, PROT_READ | PROT_WRITE,
+                     shareFlag | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return map == MAP_FAILED ? nullptr : static_cast<uint8_t *>(map);
+}
+
+void FuzzingAST::registerGuards(uint32_t *start, uint32_t *stop) {
+    if (start == stop || *start)
+        return;
+    if (!seenBuckets) {
+        uint8_t *trace = mapCoverage(MAP_PRIVATE);
+        seenBuckets = mapCoverage(MAP_SHARED);
+        if (!trace || !seenBuckets)
+            std::abort();
+        traceMap = trace;
+    }
+    for (uint32_t *x = start; x < stop; ++x) {
+        ++numGuards;
+        *x = numGuards < COVERAGE_MAP_SIZE ? numGuards : 0;
+    }
+    const size_t used = std::min<size_t>(numGuards + 1, COVERAGE_MAP_SIZE);
+    traceWords = (used + 7) / 8;
+}
+
+void FuzzingAST::resetTrace() {
+    std::memset(traceMap, 0, traceWords * 8);
+}
+
+uint32_t FuzzingAST::commitTrace() {
+    if (!seenBuckets)
+        return 0;
+    traceMap[0] = 0;
+    uint32_t found = 0;
+    const auto *trace = reinterpret_cast<const uint64_t *>(traceMap);
+    const auto *seen = reinterpret_cast<const uint64_t *>(seenBuckets);
+    recordBits.resize((traceWords + 7) / 8);
+    for (size_t w = 0; w < traceWords; ++w) {
+        // almost every word is zero, keep this loop tight
+        if (!trace[w])
+            continue;
+        uint64_t &recorded = recordBits[w / 8];
+        for (size_t b = 0; b < 8; ++b) {
+            const uint64_t bit = uint64_t(1) << ((w % 8) * 8 + b);
+            if ((trace[w] >> (b * 8)) & 0xff && !(recorded & bit)) {
+                recorded |= bit;
+                recordedEdges.push_back(w * 8 + b);
+            }
+        }
+        uint64_t classified = 0;
+        for (size_t b = 0; b < 8; ++b)
+            classified |= uint64_t(COUNT_CLASS[(trace[w] >> (b * 8)) & 0xff])
+                          << (b * 8);
+        if (!(classified & ~seen[w]))
+            continue;
+        for (size_t b = 0; b < 8; ++b) {
+            const uint8_t bucket = (classified >> (b * 8)) & 0xff;
+            if (!bucket)
+                continue;
+            const uint8_t old = __atomic_fetch_or(&seenBuckets[w * 8 + b],
+                                                  bucket, __ATOMIC_RELAXED);
+            if (bucket & ~old)
+                ++found;
+        }
+    }
+    return found;
+}
+
+std::vector<uint32_t> FuzzingAST::takeEdgeRecord() {
+    for (uint32_t id : recordedEdges)
+        recordBits[id / 64] &= ~(uint64_t(1) << (id % 64));
+    std::sort(recordedEdges.begin(), recordedEdges.end());
+    return std::exchange(recordedEdges, {});
+}
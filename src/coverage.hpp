@@ -0,0 +1,56 @@
+#ifndef COVERAGE_HPP
+#define COVERAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern uint32_t newEdgeCnt;
+
+namespace FuzzingAST {
+// AFL-style coverage: every guard id owns one byte of a per-process trace
+// map holding the hit count of the current execution. After the execution
+// the counts are bucketed (1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+) and
+// compared with the buckets seen so far by any process of this run, kept in
+// a MAP_SHARED map so forked children and -jobs workers share novelty.
+constexpr size_t COVERAGE_MAP_SIZE = 1 << 24;
+extern uint8_t *traceMap;
+
+// number the guards of one module and map the coverage maps, called from
+// the guard init hook, i.e. before any fork
+void registerGuards(uint32_t *start, uint32_t *stop);
+// clear the hit counts before an execution
+void resetTrace();
+// merge the current trace into the seen buckets, returns the number of new
+// (edge, bucket) pairs
+uint32_t commitTrace();
+// sorted ids of every edge hit by the traces committed since the last call,
+// used to attribute coverage to the current corpus entry
+std::vector<uint32_t> takeEdgeRecord();
+
+// saturating, a hot edge stays in the 128+ bucket instead of wrapping to 0
+__attribute__((no_sanitize("coverage"))) inline void traceEdge(uint32_t id) {
+    traceMap[id] += traceMap[id] != 0xff;
+}
+
+// traces one execution and adds its novel coverage to newEdgeCnt
+class TraceScope {
+  public:
+    TraceScope() { resetTrace(); }
+    ~TraceScope() { end(); }
+    // commit before the scope ends, e.g. so repairs calling into the
+    // interpreter aren't counted as the execution's coverage
+    void end() {
+        if (active_)
+            newEdgeCnt += commitTrace();
+        active_ = false;
+    }
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+  private:
+    bool active_ = true;
+};
+} // namespace FuzzingAST
+
+#endif // COVERAGE_HPP
@@ -0,0 +1,166 @@
+#ifndef COW_HPP
+#define COW_HPP
+
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace FuzzingAST {
+// Vector split into fixed-size chunks shared between copies. Copying only
+// bumps the chunk refcounts, the first write through a non-const accessor
+// clones the chunk it lands in. Elements never move on growth, but a
+// reference taken before the container was copied must not be written to.
+template <typename T, size_t ChunkBits = 5> class CowVector {
+    static constexpr size_t CHUNK = size_t(1) << ChunkBits;
+    using Chunk = std::vector<T>;
+
+    template <bool Const> class Iter {
+        using Owner = std::conditional_t<Const, const CowVector, CowVector>;
+
+      public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T *, T *>;
+        using reference = std::conditional_t<Const, const T &, T &>;
+
+        Iter() = default;
+        Iter(Owner *v, size_t i) : v_(v), i_(i) {}
+        reference operator*() const { return (*v_)[i_]; }
+        pointer operator->() const { return &(*v_)[i_]; }
+        reference operator[](difference_type n) const { return (*v_)[i_ + n]; }
+        Iter &operator++() { return ++i_, *this; }
+        Iter operator++(int) { return Iter(v_, i_++); }
+        Iter &operator--() { return --i_, *this; }
+        Iter operator--(int) { return Iter(v_, i_--); }
+        Iter &operator+=(difference_type n) { return i_ += n, *this; }
+        Iter &operator-=(difference_type n) { return i_ -= n, *this; }
+        Iter operator+(difference_type n) const { return Iter(v_, i_ + n); }
+        friend Iter operator+(difference_type n, Iter it) { return it + n; }
+        Iter operator-(difference_type n) const { return Iter(v_, i_ - n); }
+        difference_type operator-(const Iter &o) const {
+            return static_cast<difference_type>(i_) -
+                   static_cast<difference_type>(o.i_);
+        }
+        bool operator==(const Iter &o) const { return i_ == o.i_; }
+        auto operator<=>(const Iter &o) const { return i_ <=> o.i_; }
+        size_t index() const { return i_; }
+
+      private:
+        Owner *v_ = nullptr;
+        size_t i_ = 0;
+    };
+
+  public:
+    using value_type = T;
+    using size_type = size_t;
+    using iterator = Iter<false>;
+    using const_iterator = Iter<true>;
+
+    CowVector() = default;
+    CowVector(std::initializer_list<T> init) { assign(init.begin(), init.end()); }
+    CowVector(const std::vector<T> &v) { assign(v.begin(), v.end()); }
+    CowVector &operator=(const std::vector<T> &v) {
+        clear();
+        assign(v.begin(), v.end());
+        return *this;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    // copies of each other that neither wrote to since, so equal
+    bool sharesChunks(const CowVector &o) const {
+        return size_ == o.size_ && chunks_ == o.chunks_;
+    }
+
+    const T &operator[](size_t i) const {
+        return (*chunks_[i >> ChunkBits])[i & (CHUNK - 1)];
+    }
+    T &operator[](size_t i) {
+        return writable(i >> ChunkBits)[i & (CHUNK - 1)];
+    }
+    const T &at(size_t i) const {
+        if (i >= size_)
+            throw std::out_of_range("CowVector::at");
+        return (*this)[i];
+    }
+    T &at(size_t i) {
+        if (i >= size_)
+            throw std::out_of_range("CowVector::at");
+        return (*this)[i];
+    }
+    const T &back() const { return (*this)[size_ - 1]; }
+    T &back() { return (*this)[size_ - 1]; }
+
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, size_}; }
+    iterator begin() { return {this, 0}; }
+    iterator end() { return {this, size_}; }
+
+    template <typename... Args> T &emplace_back(Args &&...args) {
+        if ((size_ & (CHUNK - 1)) == 0) {
+            chunks_.push_back(std::make_shared<Chunk>());
+            chunks_.back()->reserve(CHUNK);
+        }
+        auto &chunk = writable(chunks_.size() - 1);
+        chunk.emplace_back(std::forward<Args>(args)...);
+        ++size_;
+        return chunk.back();
+    }
+    void push_back(const T &v) { emplace_back(v); }
+    void push_back(T &&v) { emplace_back(std::move(v)); }
+    void pop_back() { resize(size_ - 1); }
+
+    void resize(size_t n) { resize(n, T{}); }
+    void resize(size_t n, const T &v) {
+        if (n < size_) {
+            chunks_.resize((n + CHUNK - 1) >> ChunkBits);
+            if (n & (CHUNK - 1))
+                writable(chunks_.size() - 1).resize(n & (CHUNK - 1));
+            size_ = n;
+        }
+        while (size_ < n)
+            emplace_back(v);
+    }
+    void reserve(size_t) {}
+    void clear() {
+        chunks_.clear();
+        size_ = 0;
+    }
+
+    // only appending is supported
+    template <bool Const, typename It>
+    iterator insert(Iter<Const> pos, It first, It last) {
+        if (pos.index() != size_)
+            throw std::logic_error("CowVector::insert only appends");
+        const auto at = size_;
+        assign(first, last);
+        return {this, at};
+    }
+
+  private:
+    template <typename It> void assign(It first, It last) {
+        for (; first != last; ++first)
+            emplace_back(*first);
+    }
+
+    Chunk &writable(size_t c) {
+        auto &chunk = chunks_[c];
+        if (chunk.use_count() > 1) {
+            auto copy = std::make_shared<Chunk>();
+            copy->reserve(CHUNK);
+            copy->assign(chunk->begin(), chunk->end());
+            chunk = std::move(copy);
+        }
+        return *chunk;
+    }
+
+    std::vector<std::shared_ptr<Chunk>> chunks_;
+    size_t size_ = 0;
+};
+} // namespace FuzzingAST
+
+#endif // COW_HPP
@@ -0,0 +1,138 @@
+#include "crash.hpp"
+#include "binser.hpp"
+#include "emit.hpp"
+#include "jobs.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+using namespace FuzzingAST;
+
+CrashState FuzzingAST::crashState;
+
+// MAGIC, records, then a 0 byte terminating the valid part; a BinSer file
+// that parseAST reads as the AST with the journaled lines
+static constexpr size_t JOURNAL_SIZE = 16 << 20;
+static char *journal = nullptr;
+static size_t journalEnd = 0;
+static size_t lineStart = 0;
+static std::string journalFile;
+static std::string scratch;
+// copy of the journaled AST, sharing its chunks, and where its record ends
+static AST journaledAST;
+static size_t astEnd = 0;
+
+void FuzzingAST::openJournal() {
+    fs::create_directories("corpus/crash");
+    journalFile = Jobs::workerID >= 0
+                      ? "corpus/crash/journal_w" +
+                            std::to_string(Jobs::workerID) + ".bin"
+                      : "corpus/crash/journal.bin";
+    // a run that ended between executions left the header alone, only a
+    // record behind it is a reproducer
+    char head[BinSer::MAGIC.size() + 1] = {};
+    std::ifstream(journalFile, std::ios::binary).read(head, sizeof(head));
+    if (head[BinSer::MAGIC.size()] != 0) {
+        std::error_code ec;
+        fs::rename(journalFile, "corpus/crash/" + make_unique_filename(0), ec);
+    }
+
+    const int fd = open(journalFile.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+        return;
+    if (ftruncate(fd, JOURNAL_SIZE) == 0) {
+        void *map = mmap(nullptr, JOURNAL_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED)
+            journal = static_cast<char *>(map);
+    }
+    close(fd);
+    if (!journal)
+        return;
+    std::memcpy(journal, BinSer::MAGIC.data(), BinSer::MAGIC.size());
+    journalEnd = BinSer::MAGIC.size();
+    journal[journalEnd] = 0;
+}
+
+const char *FuzzingAST::journalPath() {
+    return journal ? journalFile.c_str() : "";
+}
+
+// plain stores into the mapping, the page cache outlives the process
+static void append() {
+    if (journalEnd + scratch.size() + 1 > JOURNAL_SIZE)
+        return;
+    std::memcpy(journal + journalEnd, scratch.data(), scratch.size());
+    journalEnd += scratch.size();
+    journal[journalEnd] = 0;
+}
+
+// cheap, a copy shares the chunks until either side writes
+static bool isJournaled(const AST &ast) {
+    return astEnd != 0 && ast.scopes.sharesChunks(journaledAST.scopes) &&
+           ast.declarations.sharesChunks(journaledAST.declarations) &&
+           ast.expressions.sharesChunks(journaledAST.expressions) &&
+           ast.variables.sharesChunks(journaledAST.variables) &&
+           ast.nameCnt == journaledAST.nameCnt &&
+           ast.importedModules == journaledAST.importedModules &&
+           std::ranges::equal(ast.classProps, journaledAST.classProps);
+}
+
+void FuzzingAST::journalAST(const AST &ast) {
+    if (!journal)
+        return;
+    if (isJournaled(ast)) {
+        // journalClear only zeroed the kind byte, the record is still there
+        journal[BinSer::MAGIC.size()] =
+            static_cast<char>(BinSer::RecordKind::AST);
+        journalEnd = astEnd;
+        journal[journalEnd] = 0;
+        return;
+    }
+    scratch.clear();
+    BinSer::encodeRecord(scratch, ast);
+    journalEnd = BinSer::MAGIC.size();
+    astEnd = 0;
+    append();
+    if (journalEnd > BinSer::MAGIC.size()) {
+        journaledAST = ast;
+        astEnd = journalEnd;
+    }
+}
+
+void FuzzingAST::journalClear() {
+    if (!journal)
+        return;
+    journalEnd = BinSer::MAGIC.size();
+    journal[journalEnd] = 0;
+}
+
+void FuzzingAST::journalLine(const ASTNode &line) {
+    if (!journal)
+        return;
+    scratch.clear();
+    BinSer::encodeRecord(scratch, line);
+    lineStart = journalEnd;
+    append();
+}
+
+std::string FuzzingAST::journalKeep() {
+    static int counter = 0;
+    if (!journal || journal[BinSer::MAGIC.size()] == 0)
+        return "";
+    auto path = "corpus/crash/" + make_unique_filename(counter++);
+    std::ofstream(path, std::ios::binary).write(journal, journalEnd);
+    return path;
+}
+
+void FuzzingAST::journalDropLine() {
+    if (!journal)
+        return;
+    journalEnd = lineStart;
+    journal[journalEnd] = 0;
+}
@@ -0,0 +1,60 @@
+#ifndef CRASH_HPP
+#define CRASH_HPP
+
+#include "ast.hpp"
+#include <string>
+#include <vector>
+
+namespace FuzzingAST {
+// Live state of the current execution. Its binary form is mirrored into an
+// mmap'd journal file, so a dying process leaves a reproducer behind without
+// serializing anything in the crash handler.
+struct CrashState {
+    // AST being executed
+    const AST *ast = nullptr;
+    // lines already executed on ast
+    const std::vector<ASTNode> *lines = nullptr;
+    // line in flight
+    const ASTNode *line = nullptr;
+};
+extern CrashState crashState;
+
+// map corpus/crash/journal[_w<id>].bin, a leftover journal of the previous
+// run is kept under a unique name first if it holds a record
+void openJournal();
+// journal path for the crash message, empty if the journal isn't mapped
+const char *journalPath();
+// restart the journal with ast
+void journalAST(const AST &ast);
+// nothing in flight, the journal is no reproducer
+void journalClear();
+// append the line about to run, dropped again if it doesn't succeed
+void journalLine(const ASTNode &line);
+void journalDropLine();
+// keep a copy of the journal as a reproducer of a crash this process
+// survived, e.g. of a fork server child. Returns its path, empty if none
+std::string journalKeep();
+
+// points crashState at an AST for a scope and restores the previous state
+class CrashStateScope {
+  public:
+    explicit CrashStateScope(const AST &ast,
+                             const std::vector<ASTNode> *lines = nullptr)
+        : saved_(crashState) {
+        crashState = {&ast, lines, nullptr};
+        journalAST(ast);
+    }
+    ~CrashStateScope() {
+        crashState = saved_;
+        if (!crashState.ast)
+            journalClear();
+    }
+    CrashStateScope(const CrashStateScope &) = delete;
+    CrashStateScope &operator=(const CrashStateScope &) = delete;
+
+  private:
+    CrashState saved_;
+};
+} // namespace FuzzingAST
+
+#endif // CRASH_HPP
@@ -7,12 +7,28 @@
 #include <unordered_set>
 
 namespace FuzzingAST {
+// run* return 0 on success, -1 on error, -2 on timeout (execution context is
+// lost) and -3 on timeout when the context survived (fork server or an
+// interrupted interpreter)
 int runAST(AST &, BuiltinContext &, std::unique_ptr<ExecutionContext> &excCtx,
            bool echo = false);
 int runLines(const std::vector<ASTNode> &nodes, AST &, BuiltinContext &ctx,
              std::unique_ptr<ExecutionContext> &excCtx, bool echo = false);
 int runLine(const ASTNode &node, AST &, BuiltinContext &ctx,
             std::unique_ptr<ExecutionContext> &excCtx, bool echo = false);
+// outcome of one line of a batch, newEdges is the coverage it added
+struct LineResult {
+    int ret = 0;
+    uint32_t newEdges = 0;
+};
+// run nodes in order under a single timeout, each line traced on its own and
+// a failing line doesn't stop the rest. Returns 0, or -2/-3 as runLine for
+// the line that timed out, earlier lines keep their results and later ones
+// are marked with the same code. excCtx is checkpointed after every line that
+// succeeded
+int runBatch(const std::vector<ASTNode> &nodes, AST &, BuiltinContext &ctx,
+             std::unique_ptr<ExecutionContext> &excCtx,
+             std::vector<LineResult> &results);
 int initialize(int *, char ***);
 int finalize();
 void loadBuiltinsFuncs(BuiltinContext &ctx);
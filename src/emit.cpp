@@ -1,5 +1,6 @@
 #include "emit.hpp"
-#include "serialization.hpp"
+#include "binser.hpp"
+#include "jobs.hpp"
 #include <chrono>
 #include <filesystem>
 #include <fstream>
@@ -12,30 +13,41 @@ using namespace FuzzingAST;
 
 std::vector<std::string> FuzzingAST::cacheCorpus;
 
-// Generate unique filename using timestamp + counter
+// Generate unique filename using timestamp + (worker) + counter
 std::string FuzzingAST::make_unique_filename(int counter) {
     auto now = std::chrono::system_clock::now().time_since_epoch();
     auto millis =
         std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
-    return std::to_string(millis) + "_" + std::to_string(counter) + ".json";
+    std::string worker = Jobs::workerID >= 0
+                             ? "_w" + std::to_string(Jobs::workerID)
+                             : "";
+    return std::to_string(millis) + worker + "_" + std::to_string(counter) +
+           ".bin";
 }
 
 void FuzzingAST::fuzzerLoadCorpus(const std::string &savedPath,
                                   std::deque<ASTData> &corpus) {
     corpus.clear();
+    // adopt the files so dropped entries are removed, unless they are not
+    // ours. Runs before -jobs forks, FuzzerInitialize disowns them again in
+    // all workers but 0
+    std::error_code ec;
+    const bool adopt = fs::equivalent(savedPath, "corpus/saved", ec);
     std::set<std::string> pathes;
     for (const auto &entry : fs::directory_iterator(savedPath)) {
-        if (entry.is_regular_file() && entry.path().extension() == ".json")
+        const auto ext = entry.path().extension();
+        if (entry.is_regular_file() && (ext == ".bin" || ext == ".json"))
             pathes.insert(entry.path().string());
     }
     for (const auto &entry : pathes) {
-        std::ifstream in(entry);
+        std::ifstream in(entry, std::ios::binary);
         if (in) {
             std::string content((std::istreambuf_iterator<char>(in)),
                                 std::istreambuf_iterator<char>());
-            auto jsonData = nlohmann::json::parse(content);
             ASTData astData;
-            astData.ast = jsonData.get<AST>();
+            astData.ast = BinSer::parseAST(content);
+            if (adopt)
+                astData.savedPath = entry;
 
             corpus.push_back(astData);
         }
@@ -53,7 +65,7 @@ void FuzzingAST::fuzzerEmitCacheCorpus() {
 
         // 1. Write to temp
         {
-            std::ofstream out(tmpPath);
+            std::ofstream out(tmpPath, std::ios::binary);
             out << FuzzingAST::cacheCorpus[i];
         }
 
@@ -61,3 +73,44 @@ void FuzzingAST::fuzzerEmitCacheCorpus() {
         fs::rename(tmpPath, queuePath);
     }
 }
+
+void FuzzingAST::fuzzerSaveEntry(ASTData &data) { data.unsaved = true; }
+
+void FuzzingAST::fuzzerFlushSaved(std::deque<ASTData> &corpus) {
+    using Clock = std::chrono::steady_clock;
+    static auto lastFlush = Clock::now();
+    static int counter = 0;
+    if (Clock::now() - lastFlush < std::chrono::seconds(SAVE_INTERVAL))
+        return;
+    lastFlush = Clock::now();
+    // a crash loses at most SAVE_INTERVAL of queued entries
+    if (!cacheCorpus.empty()) {
+        fuzzerEmitCacheCorpus();
+        cacheCorpus.clear();
+    }
+    fs::create_directories("corpus/tmp");
+    fs::create_directories("corpus/saved");
+    for (auto &data : corpus) {
+        if (!data.unsaved)
+            continue;
+        const std::string filename = make_unique_filename(counter++);
+        fs::path tmpPath = "corpus/tmp/" + filename;
+        {
+            std::ofstream out(tmpPath, std::ios::binary);
+            out << BinSer::encodeFile(data.ast);
+        }
+        // a saved entry is replaced in place
+        if (data.savedPath.empty())
+            data.savedPath = "corpus/saved/" + filename;
+        fs::rename(tmpPath, data.savedPath);
+        data.unsaved = false;
+    }
+}
+
+void FuzzingAST::fuzzerDropEntry(ASTData &data) {
+    if (data.savedPath.empty())
+        return;
+    std::error_code ec;
+    fs::remove(data.savedPath, ec);
+    data.savedPath.clear();
+}
@@ -7,10 +7,18 @@
 
 namespace FuzzingAST {
 constexpr size_t MAX_CACHE_SIZE = 100;
+// seconds between writes of changed corpus/saved entries
+constexpr int SAVE_INTERVAL = 5;
 extern std::vector<std::string> cacheCorpus;
 void fuzzerEmitCacheCorpus();
 void fuzzerLoadCorpus(const std::string &savedPath,
                       std::deque<ASTData> &corpus);
+// keep corpus/saved in sync with the scheduler corpus, one file per entry.
+// Saving only marks the entry, fuzzerFlushSaved writes the marked ones and the
+// queued cacheCorpus once SAVE_INTERVAL passed; dropping removes the file
+void fuzzerSaveEntry(ASTData &data);
+void fuzzerDropEntry(ASTData &data);
+void fuzzerFlushSaved(std::deque<ASTData> &corpus);
 std::string make_unique_filename(int counter);
 } // namespace FuzzingAST
 
@@ -0,0 +1,180 @@
+#include "feedback.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+using namespace FuzzingAST;
+
+static std::vector<const FeedbackMatcher *> &tables() {
+    static std::vector<const FeedbackMatcher *> all;
+    return all;
+}
+
+size_t FeedbackMatch::num(size_t i) const {
+    size_t value = 0;
+    const auto hole = holes[i];
+    const auto [ptr, ec] =
+        std::from_chars(hole.data(), hole.data() + hole.size(), value);
+    return ec == std::errc() && ptr == hole.data() + hole.size() ? value : 0;
+}
+
+FeedbackMatcher::FeedbackMatcher() { tables().push_back(this); }
+
+FeedbackMatcher::~FeedbackMatcher() { std::erase(tables(), this); }
+
+void FeedbackMatcher::addRule(const char *name, std::string_view pattern) {
+    if (rules_.size() == MAX_RULES)
+        PANIC("Too many feedback rules, adding '{}'", name);
+    if (pattern.empty())
+        PANIC("Empty feedback rule '{}'", name);
+    Rule rule{{}, 0};
+    uint8_t slots = 0;
+    for (size_t pos = 0; pos < pattern.size();) {
+        const auto open = pattern.find('{', pos);
+        if (open != pos) {
+            const auto text = pattern.substr(pos, open - pos);
+            rule.segments.push_back({std::string(text)});
+            pos += text.size();
+            continue;
+        }
+        if (pattern.size() < pos + 3 || pattern[pos + 2] != '}')
+            PANIC("Bad hole in feedback rule '{}': {}", name, pattern);
+        Segment seg;
+        switch (pattern[pos + 1]) {
+        case 's':
+            seg.hole = Hole::NonSpace;
+            break;
+        case 'd':
+            seg.hole = Hole::Digit;
+            break;
+        case 'w':
+            seg.hole = Hole::Word;
+            break;
+        case 'q':
+            seg.hole = Hole::NoQuote;
+            break;
+        default:
+            PANIC("Bad hole in feedback rule '{}': {}", name, pattern);
+        }
+        // two holes in a row would need backtracking
+        if (!rule.segments.empty() &&
+            rule.segments.back().hole != Hole::None)
+            PANIC("Adjacent holes in feedback rule '{}': {}", name, pattern);
+        if (slots == FeedbackMatch::MAX_HOLES)
+            PANIC("Too many holes in feedback rule '{}'", name);
+        seg.slot = slots++;
+        rule.segments.push_back(std::move(seg));
+        pos += 3;
+    }
+    for (size_t i = 1; i < rule.segments.size(); ++i)
+        if (rule.segments[i].text.size() >
+            rule.segments[rule.anchor].text.size())
+            rule.anchor = i;
+    const auto &anchor = rule.segments[rule.anchor].text;
+    if (anchor.size() < 2)
+        PANIC("Feedback rule '{}' needs a literal of 2+ chars", name);
+
+    buckets_[bucket(anchor[0], anchor[1])].push_back(rules_.size());
+    rules_.push_back(std::move(rule));
+    matches_.emplace_back();
+    stats_.push_back({name});
+}
+
+bool FeedbackMatcher::inHole(Hole hole, char c) {
+    const auto u = static_cast<unsigned char>(c);
+    switch (hole) {
+    case Hole::NonSpace:
+        return !std::isspace(u);
+    case Hole::Digit:
+        return std::isdigit(u);
+    case Hole::Word:
+        return std::isalnum(u) || c == '_';
+    case Hole::NoQuote:
+        return c != '\'';
+    default:
+        return false;
+    }
+}
+
+bool FeedbackMatcher::matchAt(const Rule &rule, std::string_view msg,
+                              size_t pos, FeedbackMatch &out) const {
+    const auto &segs = rule.segments;
+    // forward from the end of the anchor
+    size_t cur = pos + segs[rule.anchor].text.size();
+    for (size_t k = rule.anchor + 1; k < segs.size(); ++k) {
+        const auto &seg = segs[k];
+        if (seg.hole == Hole::None) {
+            if (!msg.substr(cur).starts_with(seg.text))
+                return false;
+            cur += seg.text.size();
+            continue;
+        }
+        auto end = cur;
+        while (end < msg.size() && inHole(seg.hole, msg[end]))
+            ++end;
+        if (k + 1 < segs.size()) {
+            const auto &next = segs[k + 1].text;
+            while (end > cur && !msg.substr(end).starts_with(next))
+                --end;
+        }
+        if (end == cur)
+            return false;
+        out.holes[seg.slot] = msg.substr(cur, end - cur);
+        cur = end;
+    }
+    // backward from its start
+    cur = pos;
+    for (size_t k = rule.anchor; k-- > 0;) {
+        const auto &seg = segs[k];
+        if (seg.hole == Hole::None) {
+            if (cur < seg.text.size() ||
+                msg.substr(cur - seg.text.size(), seg.text.size()) != seg.text)
+                return false;
+            cur -= seg.text.size();
+            continue;
+        }
+        auto start = cur;
+        while (start > 0 && inHole(seg.hole, msg[start - 1]))
+            --start;
+        if (k > 0) {
+            const std::string_view prev = segs[k - 1].text;
+            while (start < cur && !msg.substr(0, start).ends_with(prev))
+                ++start;
+        }
+        if (start == cur)
+            return false;
+        out.holes[seg.slot] = msg.substr(start, cur - start);
+        cur = start;
+    }
+    return true;
+}
+
+uint64_t FeedbackMatcher::match(std::string_view msg) {
+    const uint64_t all = rules_.size() == MAX_RULES
+                             ? ~uint64_t(0)
+                             : (uint64_t(1) << rules_.size()) - 1;
+    uint64_t matched = 0;
+    for (size_t i = 0; i + 1 < msg.size() && matched != all; ++i) {
+        for (const auto r : buckets_[bucket(msg[i], msg[i + 1])]) {
+            const auto bit = uint64_t(1) << r;
+            if (matched & bit)
+                continue;
+            const auto &rule = rules_[r];
+            if (msg.substr(i).starts_with(rule.segments[rule.anchor].text) &&
+                matchAt(rule, msg, i, matches_[r])) {
+                matched |= bit;
+                ++stats_[r].hits;
+                ++feedbackHits;
+            }
+        }
+    }
+    return matched;
+}
+
+void FuzzingAST::logFeedbackStats() {
+    for (const auto *table : tables())
+        for (const auto &rule : table->stats())
+            INFO("Feedback rule {}: {} hits, {} fixes", rule.name, rule.hits,
+                 rule.fixes);
+}
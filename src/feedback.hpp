@@ -0,0 +1,124 @@
+#ifndef FEEDBACK_HPP
+#define FEEDBACK_HPP
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+extern uint64_t feedbackHits;
+extern uint64_t feedbackFixes;
+
+namespace FuzzingAST {
+// Error-message rules driving the builtin signature repair. A pattern is
+// literal text with holes: {s} a run of non-space chars, {d} digits, {w} word
+// chars and {q} anything but a quote. A hole takes the longest run that the
+// neighbouring literal still matches next to, there is no backtracking past
+// that. Rules are compiled once, a message is scanned a single time and only
+// rules whose longest literal starts at the current position are verified.
+
+// holes of one match, numbered in pattern order
+struct FeedbackMatch {
+    static constexpr size_t MAX_HOLES = 6;
+    std::array<std::string_view, MAX_HOLES> holes;
+
+    std::string str(size_t i) const { return std::string(holes[i]); }
+    // hole as a number, 0 if it isn't one
+    size_t num(size_t i) const;
+};
+
+class FeedbackMatcher {
+  public:
+    struct RuleStats {
+        const char *name;
+        uint64_t hits = 0;  // messages matched
+        uint64_t fixes = 0; // matches the action repaired something for
+    };
+    static constexpr size_t MAX_RULES = 64;
+
+    FeedbackMatcher(const FeedbackMatcher &) = delete;
+    FeedbackMatcher &operator=(const FeedbackMatcher &) = delete;
+    const std::vector<RuleStats> &stats() const { return stats_; }
+
+  protected:
+    FeedbackMatcher();
+    ~FeedbackMatcher();
+    void addRule(const char *name, std::string_view pattern);
+    // bit i set if rule i matches msg, the holes are kept until the next call
+    uint64_t match(std::string_view msg);
+    const FeedbackMatch &matchOf(size_t rule) const { return matches_[rule]; }
+    void recordFix(size_t rule) {
+        ++stats_[rule].fixes;
+        ++feedbackFixes;
+    }
+
+  private:
+    enum class Hole : uint8_t { None, NonSpace, Digit, Word, NoQuote };
+    struct Segment {
+        std::string text; // literal, empty for a hole
+        Hole hole = Hole::None;
+        uint8_t slot = 0; // index into FeedbackMatch::holes
+    };
+    struct Rule {
+        std::vector<Segment> segments;
+        size_t anchor; // longest literal, the one the scan looks for
+    };
+
+    static bool inHole(Hole hole, char c);
+    static size_t bucket(char a, char b) {
+        return (static_cast<uint8_t>(a) * 31u + static_cast<uint8_t>(b)) &
+               0xff;
+    }
+    bool matchAt(const Rule &rule, std::string_view msg, size_t pos,
+                 FeedbackMatch &out) const;
+
+    std::vector<Rule> rules_;
+    std::vector<FeedbackMatch> matches_;
+    std::vector<RuleStats> stats_;
+    // rule ids by the first two bytes of their anchor
+    std::array<std::vector<uint8_t>, 256> buckets_;
+};
+
+// rule table for one target, Env carries what the actions repair
+template <typename Env> class FeedbackTable : public FeedbackMatcher {
+  public:
+    // returns true if it repaired something
+    using Action = bool (*)(Env &, const FeedbackMatch &);
+    struct Rule {
+        const char *name;
+        const char *pattern;
+        Action action;
+    };
+
+    FeedbackTable(std::initializer_list<Rule> rules) {
+        for (const auto &rule : rules) {
+            addRule(rule.name, rule.pattern);
+            actions_.push_back(rule.action);
+        }
+    }
+
+    // runs the matching rules in table order until one repairs something,
+    // returns its index or -1
+    int dispatch(std::string_view msg, Env &env) {
+        for (auto bits = match(msg); bits; bits &= bits - 1) {
+            const auto r = static_cast<size_t>(std::countr_zero(bits));
+            if (actions_[r](env, matchOf(r))) {
+                recordFix(r);
+                return static_cast<int>(r);
+            }
+        }
+        return -1;
+    }
+
+  private:
+    std::vector<Action> actions_;
+};
+
+// per-rule hit and repair counts of every table
+void logFeedbackStats();
+} // namespace FuzzingAST
+
+#endif // FEEDBACK_HPP
@@ -1,13 +1,20 @@
 #include "FuzzSchedulerState.hpp"
 #include "UI.hpp"
 #include "ast.hpp"
+#include "binser.hpp"
+#include "coverage.hpp"
+#include "crash.hpp"
 #include "driver.hpp"
 #include "emit.hpp"
+#include "feedback.hpp"
 #include "fuzzer.hpp"
+#include "jobs.hpp"
+#include "latency.hpp"
+#include "learned.hpp"
 #include "log.hpp"
 #include "mutators.hpp"
-#include "serialization.hpp"
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <execinfo.h>
@@ -28,18 +35,23 @@ using namespace FuzzingAST;
 extern "C" void __sanitizer_set_death_callback(void (*)(void));
 extern std::vector<std::string> FuzzingAST::cacheCorpus;
 
-std::string data_backup;
-std::string data_backup2;
 static size_t totalRounds = 0;
 static FuzzSchedulerState scheduler;
+// generated lines run per runBatch call, 1 runs them one by one
+static size_t batchSize = 1;
 uint32_t newEdgeCnt = 0;
 uint32_t errCnt = 0;
 uint32_t corpusSize = 0;
+uint64_t codeCacheHits = 0;
+uint64_t codeCacheMisses = 0;
+uint64_t feedbackHits = 0;
+uint64_t feedbackFixes = 0;
+uint64_t timeoutCnt = 0;
 
 std::mt19937 rng(std::random_device{}());
 
 static int testOneInput(ASTData &data, BuiltinContext &ctx) {
-    data_backup = nlohmann::json(data.ast).dump();
+    CrashStateScope crashScope(data.ast);
     auto tmp = getInitExecutionContext();
     return runAST(data.ast, ctx, tmp);
 }
@@ -54,15 +66,14 @@ static void print_backtrace() {
 
 static void crash_handler() {
     WRITE_STDOUT("crash! dump last state\n");
-    WRITE_STDERR("\n===AST===\n");
-    WRITE_STDERR(data_backup.c_str());
-    WRITE_STDERR(data_backup2.c_str());
-    fuzzerEmitCacheCorpus();
-    int cnt = 0;
-    for (const auto &data : scheduler.corpus) {
-        std::ofstream out("corpus/saved/" + std::to_string(cnt++) + ".json");
-        out << nlohmann::json(data.ast).dump();
+    // the journal already holds the AST and lines, nothing to serialize here
+    if (crashState.ast && *journalPath()) {
+        WRITE_STDERR("\n===Reproducer===\n");
+        WRITE_STDERR(journalPath());
+        WRITE_STDERR("\n");
     }
+    // nothing else is written from a dying process, queued and unsaved
+    // entries are flushed every SAVE_INTERVAL on the normal path
     // backtrace already printed by sanitizer
     _exit(1);
 }
@@ -97,17 +108,43 @@ void myTerminateHandler() {
 }
 
 void FuzzingAST::FuzzerInitialize(int *argc, char ***argv) {
+    int jobs = 1;
     if (argc != NULL && argv != NULL) {
-        if (*argc >= 2 && std::strcmp((*argv)[1], "-load-saved") == 0) {
-            std::string savedPath = "./corpus/saved";
-            if (*argc == 3 && (*argv)[2] != nullptr) {
-                savedPath = std::string((*argv)[2]);
+        for (int i = 1; i < *argc; ++i) {
+            if (std::strcmp((*argv)[i], "-load-saved") == 0) {
+                std::string savedPath = "./corpus/saved";
+                if (i + 1 < *argc && (*argv)[i + 1][0] != '-') {
+                    savedPath = std::string((*argv)[++i]);
+                }
+                INFO("Loading saved corpus from: {}", savedPath);
+                fuzzerLoadCorpus(savedPath, scheduler.corpus);
+                scheduler.idx = scheduler.corpus.size() - 1;
+            } else if (std::strcmp((*argv)[i], "-jobs") == 0 &&
+                       i + 1 < *argc) {
+                jobs = std::max(1, std::atoi((*argv)[++i]));
+            } else if (std::strcmp((*argv)[i], "-batch") == 0 &&
+                       i + 1 < *argc) {
+                batchSize = std::clamp(std::atoi((*argv)[++i]), 1, 64);
+            } else if (std::strcmp((*argv)[i], "-schedule") == 0 &&
+                       i + 1 < *argc) {
+                scheduler.policy = makeSchedulePolicy((*argv)[++i]);
+                if (!scheduler.policy)
+                    PANIC("Unknown schedule '{}', expected favored, uniform, "
+                          "fast or ucb",
+                          (*argv)[i]);
             }
-            INFO("Loading saved corpus from: {}", savedPath);
-            fuzzerLoadCorpus(savedPath, scheduler.corpus);
-            scheduler.idx = scheduler.corpus.size() - 1;
         }
     }
+    if (jobs > 1) {
+        // fork before the interpreter starts, each worker owns one
+        Jobs::runWorkers(jobs);
+        rng.seed(std::random_device{}() + Jobs::workerID);
+        // every worker loaded corpus/saved, only worker 0 may delete from it
+        if (Jobs::workerID != 0)
+            for (auto &entry : scheduler.corpus)
+                entry.savedPath.clear();
+    }
+    openJournal();
     initialize(argc, argv);
     // override potential SIGINT handler in language interpreter
     signal(SIGINT, sigint_handler);
@@ -118,6 +155,73 @@ void FuzzingAST::FuzzerInitialize(int *argc, char ***argv) {
     __sanitizer_set_death_callback(crash_handler);
 }
 
+// Generate up to batchSize lines and run them as one batch. Lines that fail
+// are dropped, the ones before a timeout are kept. runBatch checkpoints after
+// every good line, so a soft timeout only rolls back the hung one. Returns
+// false if not a single line could be generated.
+static bool testBatch(ASTData &ast, FuzzSchedulerState &scheduler,
+                      std::vector<ASTNode> &history,
+                      std::unordered_set<std::string> &globalVars,
+                      std::unique_ptr<ExecutionContext> &execCtx,
+                      size_t &restoredAt) {
+    auto &ctx = scheduler.ctx;
+    static std::vector<ASTNode> batch;
+    static std::vector<LineResult> results;
+    batch.clear();
+    const auto room = std::min(batchSize, 200 - history.size());
+    while (batch.size() < room) {
+        ASTNode data;
+        if (generate_line(data, ast, ctx, globalVars, 0, ast.ast.scopes[0]) !=
+            0)
+            break;
+        batch.push_back(std::move(data));
+    }
+    if (batch.empty())
+        return false;
+    for (const auto &line : batch)
+        journalLine(line);
+    const auto ret = runBatch(batch, ast.ast, ctx, execCtx, results);
+    size_t kept = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (results[i].newEdges > 0)
+            scheduler.noEdgeCount = 0;
+        else
+            ++scheduler.noEdgeCount;
+        if (results[i].ret == 0) {
+            history.push_back(batch[i]);
+            ++kept;
+        } else if (results[i].ret != -1) {
+            break; // timed out, the rest didn't run
+        }
+    }
+    if (ret == -3 && execCtx->restore()) {
+        if (!execCtx->exactRestore())
+            restoredAt = std::min(restoredAt, history.size());
+    } else if (ret != 0) {
+        // the context is lost, re-gain it with the good lines by replaying
+        // the history
+        execCtx = getInitExecutionContext();
+        const auto replayRet = runLines(history, ast.ast, ctx, execCtx);
+        if (replayRet == -1)
+            PANIC("Failed to replay lines after timeout");
+        else if (replayRet != 0)
+            PANIC("Timeout while replaying lines after timeout");
+        execCtx->checkpoint();
+    }
+    if (kept > 0)
+        updateTypes(globalVars, ast, ctx, execCtx);
+    // update index to match with new variables and fixed results
+    ctx.update(ast.ast);
+    if (kept < batch.size()) {
+        // the journal got every line up front, keep only the good ones
+        journalAST(ast.ast);
+        for (const auto &line : history)
+            journalLine(line);
+    }
+    globalVars.clear();
+    return true;
+}
+
 static std::vector<ASTNode> testInputStream(ASTData &ast,
                                             FuzzSchedulerState &scheduler) {
     // const auto genNum = ast.ast.scopes[0].declarations.size() * 2;
@@ -129,28 +233,38 @@ static std::vector<ASTNode> testInputStream(ASTData &ast,
 
     std::unordered_set<std::string> globalVars;
     auto execCtx = getInitExecutionContext();
-    data_backup2.clear();
-    data_backup = nlohmann::json(ast.ast).dump() + "\n---DECL_END---\n";
+    CrashStateScope crashScope(ast.ast, &history);
     const auto declRet = runLines(history, ast.ast, ctx, execCtx);
     // get declarations
     if (declRet != 0) {
         PANIC("Failed to run declarations.code={}", declRet);
     };
+    execCtx->checkpoint();
     history.reserve(200);
+    // history size at the first restore, lines past it ran on restored state
+    size_t restoredAt = SIZE_MAX;
     const auto scopeCnt = ast.ast.scopes.size();
     while (scheduler.noEdgeCount <= scheduler.execFailureThreshold() &&
            history.size() < 200) {
         TUI::update(scheduler, scopeCnt);
+        if (batchSize > 1) {
+            if (!testBatch(ast, scheduler, history, globalVars, execCtx,
+                           restoredAt))
+                break;
+            continue;
+        }
         ASTNode data;
         if (generate_line(data, ast, ctx, globalVars, 0, scope) != 0) {
             // can't generate a valid line, go mutate declaration
-            data_backup2.clear();
-            return std::move(history);
+            break;
         }
         const auto cacheNewEdgeCnt = newEdgeCnt;
-        data_backup2 = nlohmann::json(data).dump() + ",";
         // exec
+        crashState.line = &data;
+        journalLine(data);
         auto ret = runLine(data, ast.ast, ctx, execCtx);
+        if (ret != 0)
+            journalDropLine();
         if (cacheNewEdgeCnt < newEdgeCnt) {
             // got new edge
             scheduler.noEdgeCount = 0;
@@ -159,29 +273,45 @@ static std::vector<ASTNode> testInputStream(ASTData &ast,
             ++scheduler.noEdgeCount;
         }
         if (ret == 0) {
-            data_backup += data_backup2;
-            data_backup2.clear();
             updateTypes(globalVars, ast, ctx, execCtx);
-            scheduler.ctx.updateVars(ast.ast);
+            scheduler.ctx.update(ast.ast);
             history.push_back(data);
+            crashState.line = nullptr;
+            execCtx->checkpoint();
         } else if (ret == -1) {
             // update index to match with fixed result
             scheduler.ctx.update(ast.ast);
-        } else if (ret == -2) {
-            // timeout
-            execCtx = getInitExecutionContext();
-            // re-gain the context
-            ret = runLines(history, ast.ast, ctx, execCtx);
-            if (ret != 0) {
+        } else if (ret == -2 || ret == -3) {
+            // timeout, roll back to the last checkpoint if the context
+            // survived, otherwise re-gain it by replaying the history
+            if (execCtx->restore()) {
+                if (!execCtx->exactRestore())
+                    restoredAt = std::min(restoredAt, history.size());
+            } else {
+                execCtx = getInitExecutionContext();
+                ret = runLines(history, ast.ast, ctx, execCtx);
                 if (ret == -1)
                     PANIC("Failed to replay lines after timeout");
-                else if (ret == -2)
+                else if (ret != 0)
                     PANIC("Timeout while replaying lines after timeout");
-            };
+                execCtx->checkpoint();
+            }
         } else {
             PANIC("Unexpected return code from runLine: {}", ret);
         }
         globalVars.clear();
+        crashState.line = nullptr;
+    }
+    if (restoredAt < history.size()) {
+        // a restore keeps what the hung line changed in place, the lines run
+        // after it are kept only if the history replays from scratch
+        execCtx.reset();
+        auto replayCtx = getInitExecutionContext();
+        if (runLines(history, ast.ast, ctx, replayCtx) != 0) {
+            INFO("Dropped {} lines that didn't replay after a restore",
+                 history.size() - restoredAt);
+            history.resize(restoredAt);
+        }
     }
     return std::move(history);
 }
@@ -189,12 +319,14 @@ static std::vector<ASTNode> testInputStream(ASTData &ast,
 void FuzzingAST::fuzzerDriver() {
     cacheCorpus.reserve(MAX_CACHE_SIZE);
     loadBuiltinsFuncs(scheduler.ctx);
+    Learned::load(scheduler.ctx);
     initPrimitiveTypes(scheduler.ctx);
     {
         ASTData data;
         if (scheduler.corpus.empty()) {
             dummyAST(data, scheduler.ctx);
             scheduler.corpus.push_back(data);
+            fuzzerSaveEntry(scheduler.corpus.back());
             scheduler.idx = 0;
         } else {
             data = scheduler.corpus[scheduler.idx];
@@ -207,22 +339,35 @@ void FuzzingAST::fuzzerDriver() {
     corpusSize = scheduler.corpus.size();
     scheduler.ctx.update(scheduler.corpus[scheduler.idx].ast);
     newEdgeCnt = 0; // reset edge count
+    (void)takeEdgeRecord();
     cacheCorpus.reserve(MAX_CACHE_SIZE);
-    TUI::initTUI();
+    if (Jobs::workerID <= 0)
+        TUI::initTUI();
     while (true) {
+        corpusSize += Jobs::syncCorpus(scheduler.corpus);
+        fuzzerFlushSaved(scheduler.corpus);
         if (scheduler.corpus.empty()) {
             //     scheduler.corpus.emplace_back(std::make_shared<ASTData>());
             TUI::finalizeTUI();
             INFO("No more inputs to fuzz. Exiting.");
+            logFeedbackStats();
+            Latency::logStats();
             break;
         }
         switch (scheduler.phase) {
         case MutationPhase::ExecutionGeneration: {
             // continue generation on current
             const auto cacheNewEdgeCnt = newEdgeCnt;
-            ASTData newData = scheduler.corpus.at(scheduler.idx);
+            // coverage metadata stays with the corpus entry
+            ASTData newData{scheduler.corpus.at(scheduler.idx).ast};
             scheduler.ctx.update(newData.ast);
+            const auto roundStart = std::chrono::steady_clock::now();
             auto lines = testInputStream(newData, scheduler);
+            scheduler.recordRound(
+                newEdgeCnt - cacheNewEdgeCnt,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - roundStart)
+                    .count());
             if (cacheNewEdgeCnt < newEdgeCnt) {
                 // got new edge
                 scheduler.update(1, newData.ast.scopes.size());
@@ -235,7 +380,7 @@ void FuzzingAST::fuzzerDriver() {
                 for (size_t j = 0; j < lines.size(); ++j) {
                     exprs[j] = base + j;
                 }
-                cacheCorpus.emplace_back(nlohmann::json(newData.ast).dump());
+                cacheCorpus.emplace_back(BinSer::encodeFile(newData.ast));
                 if (cacheCorpus.size() > MAX_CACHE_SIZE) {
                     fuzzerEmitCacheCorpus();
                     cacheCorpus.clear();
@@ -248,37 +393,48 @@ void FuzzingAST::fuzzerDriver() {
         }
         case MutationPhase::FallbackOldCorpus: {
             // maybe don't remove current one?
-            scheduler.corpus.erase(scheduler.corpus.begin() + scheduler.idx);
-            --corpusSize;
+            scheduler.eraseEntry(scheduler.idx);
             newEdgeCnt = 0;
-            if (corpusSize > 0) {
-                // randomly fallback to one of all
-                scheduler.idx = rng() % corpusSize;
+            (void)takeEdgeRecord();
+            if (!scheduler.corpus.empty()) {
+                // fallback to a favored entry, culling may shrink the corpus
+                scheduler.idx = scheduler.pickFallback();
+                corpusSize = scheduler.corpus.size();
                 scheduler.update(
                     0, scheduler.corpus.at(scheduler.idx).ast.scopes.size());
                 break;
             } else {
                 scheduler.idx = 0;
                 scheduler.corpus.push_back({});
-                ++corpusSize;
+                corpusSize = 1;
             }
             [[fallthrough]];
         }
         case MutationPhase::DeclarationMutation: {
             // continue mutating on current
-            ASTData newData = scheduler.corpus.at(scheduler.idx);
+            ASTData newData{scheduler.corpus.at(scheduler.idx).ast};
             mutate_declaration(newData, scheduler.ctx);
             newData.ast.expressions.clear();
             generate_execution(newData, scheduler.ctx);
             scheduler.update(0, newData.ast.scopes.size());
-            // if current newEdgeCnt is 0, newData replaced the current one
-            if (newEdgeCnt > 0) {
+            // if current newEdgeCnt is 0 or a smaller entry hits every
+            // recorded edge, newData replaced the current one
+            if (newEdgeCnt > 0 &&
+                scheduler.admit(scheduler.idx, takeEdgeRecord())) {
                 scheduler.corpus.push_back(newData);
+                fuzzerSaveEntry(scheduler.corpus.back());
                 ++corpusSize;
                 scheduler.idx = corpusSize - 1;
-            } else
-                scheduler.corpus.at(scheduler.idx) = newData;
+            } else {
+                auto &current = scheduler.corpus.at(scheduler.idx);
+                // only the AST changes, the edges and statistics gathered
+                // while fuzzing the entry stay with it and its saved file is
+                // rewritten in place by the next flush
+                current.ast = std::move(newData.ast);
+                fuzzerSaveEntry(current);
+            }
             newEdgeCnt = 0; // reset edge count for declaration change
+            (void)takeEdgeRecord();
             break;
         }
         }
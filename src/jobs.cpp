@@ -0,0 +1,131 @@
+#include "jobs.hpp"
+#include "binser.hpp"
+#include "emit.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace FuzzingAST;
+
+int Jobs::workerID = -1;
+
+static volatile sig_atomic_t stopping = 0;
+
+static void stopHandler(int) { stopping = 1; }
+
+// keep the terminal for worker 0 (and its TUI), the others log to files
+static void redirectWorkerOutput(int id) {
+    if (id == 0)
+        return;
+    fs::create_directories("corpus/workers");
+    const auto path = "corpus/workers/" + std::to_string(id) + ".log";
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+        return;
+    dup2(fd, STDOUT_FILENO);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+}
+
+void Jobs::runWorkers(int n) {
+    std::vector<pid_t> pids(n, -1);
+    // returns true in the forked worker
+    auto spawn = [&pids](int id) {
+        const pid_t pid = fork();
+        if (pid < 0)
+            PANIC("Failed to fork worker {}: {}", id, strerror(errno));
+        if (pid == 0) {
+            workerID = id;
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            redirectWorkerOutput(id);
+            return true;
+        }
+        pids[id] = pid;
+        return false;
+    };
+
+    signal(SIGINT, stopHandler);
+    signal(SIGTERM, stopHandler);
+    for (int i = 0; i < n; ++i)
+        if (spawn(i))
+            return;
+
+    int alive = n;
+    while (alive > 0) {
+        int status = 0;
+        const pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        auto it = std::find(pids.begin(), pids.end(), pid);
+        if (it == pids.end())
+            continue;
+        --alive;
+        const int id = it - pids.begin();
+        *it = -1;
+        if (stopping)
+            continue;
+        // a crashed worker already dumped its state, keep the slot busy
+        ERROR("Worker {} exited with status {}, restarting", id, status);
+        if (spawn(id))
+            return;
+        ++alive;
+    }
+    // workers got the terminal's SIGINT themselves, the supervisor is done
+    std::exit(0);
+}
+
+size_t Jobs::syncCorpus(std::deque<ASTData> &corpus) {
+    using Clock = std::chrono::steady_clock;
+    static auto lastSync = Clock::now();
+    static std::unordered_set<std::string> synced;
+    if (workerID < 0 ||
+        Clock::now() - lastSync < std::chrono::seconds(SYNC_INTERVAL))
+        return 0;
+    lastSync = Clock::now();
+
+    fuzzerEmitCacheCorpus();
+    cacheCorpus.clear();
+
+    const std::string own = "_w" + std::to_string(workerID) + "_";
+    size_t imported = 0;
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator("corpus/queue", ec)) {
+        const auto name = entry.path().filename().string();
+        const auto ext = entry.path().extension();
+        if (name.contains(own) || (ext != ".bin" && ext != ".json") ||
+            !synced.insert(name).second)
+            continue;
+        std::ifstream in(entry.path(), std::ios::binary);
+        if (!in)
+            continue;
+        try {
+            std::string content((std::istreambuf_iterator<char>(in)),
+                                std::istreambuf_iterator<char>());
+            ASTData data;
+            data.ast = BinSer::parseAST(content);
+            corpus.push_back(std::move(data));
+            ++imported;
+        } catch (const std::exception &e) {
+            // the writer renames complete files only, skip broken ones
+            ERROR("Failed to import {}: {}", name, e.what());
+        }
+    }
+    if (imported)
+        INFO("Worker {} imported {} entries", workerID, imported);
+    return imported;
+}
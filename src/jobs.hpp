@@ -0,0 +1,20 @@
+#ifndef JOBS_HPP
+#define JOBS_HPP
+
+#include "ast.hpp"
+#include <deque>
+
+namespace FuzzingAST::Jobs {
+// index of this worker in -jobs mode, -1 when running as a single process
+extern int workerID;
+// seconds between two corpus syncs of a worker
+constexpr int SYNC_INTERVAL = 30;
+
+// fork n workers and supervise them, only returns in the workers
+void runWorkers(int n);
+// flush own new entries to corpus/queue and import the ones other workers
+// queued since the last sync, returns the number of imported entries
+size_t syncCorpus(std::deque<ASTData> &corpus);
+} // namespace FuzzingAST::Jobs
+
+#endif // JOBS_HPP
@@ -0,0 +1,146 @@
+#include "latency.hpp"
+#include "log.hpp"
+#include "serialization.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <unordered_map>
+
+using namespace FuzzingAST;
+
+namespace {
+// bucket i holds times in [2^(i-1), 2^i) ns
+struct Histogram {
+    static constexpr size_t BUCKETS = 40;
+    std::array<uint64_t, BUCKETS> counts{};
+    uint64_t samples = 0;
+    uint64_t timeouts = 0;
+
+    constexpr void add(uint64_t ns) {
+        counts[std::min<size_t>(std::bit_width(ns), BUCKETS - 1)] += 1;
+        ++samples;
+    }
+
+    // upper bound of the bucket holding the p-quantile
+    constexpr uint64_t percentile(double p) const {
+        const auto rank = static_cast<uint64_t>(p * samples);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen > rank)
+                return uint64_t(1) << i;
+        }
+        return uint64_t(1) << (BUCKETS - 1);
+    }
+};
+} // namespace
+
+static constexpr size_t KIND_CNT =
+    static_cast<size_t>(ASTNodeKind::GlobalRef) + 1;
+static std::array<Histogram, KIND_CNT> byKind;
+static std::unordered_map<SymbolID, Histogram> byCallee;
+
+// method calls are keyed by the method, the object name is per AST
+static SymbolID calleeOf(const ASTNode &node) {
+    if (node.kind != ASTNodeKind::Call || node.fields.size() < 2)
+        return NO_SYMBOL;
+    const auto *sym = std::get_if<Symbol>(&node.fields[1].val);
+    if (!sym)
+        return NO_SYMBOL;
+    return sym->dotted() ? sym->attr : sym->base;
+}
+
+static constexpr uint32_t timeoutOf(const Histogram &hist) {
+    const auto ns = hist.percentile(0.999) * Latency::SAFETY_FACTOR;
+    const auto ms = (ns + 999999) / 1000000;
+    return static_cast<uint32_t>(
+        std::clamp<uint64_t>(ms, Latency::MIN_TIMEOUT_MS,
+                             Latency::MAX_TIMEOUT_MS));
+}
+
+// the bucket and clamp math, checked when this file compiles
+static constexpr Histogram histOf(uint64_t fastNs, uint64_t fast,
+                                  uint64_t slowNs, uint64_t slow) {
+    Histogram hist;
+    for (uint64_t i = 0; i < fast; ++i)
+        hist.add(fastNs);
+    for (uint64_t i = 0; i < slow; ++i)
+        hist.add(slowNs);
+    return hist;
+}
+// 1us lands in [512ns, 1024ns), 8 * 1024ns is below the floor
+static_assert(histOf(1000, 1000, 0, 0).percentile(0.5) == 1024);
+static_assert(timeoutOf(histOf(1000, 1000, 0, 0)) == Latency::MIN_TIMEOUT_MS);
+// 20ms lands below 2^25ns, 8 * 2^25ns rounds up to 269ms
+static_assert(timeoutOf(histOf(20000000, 1000, 0, 0)) == 269);
+// one slow line in two thousand is below the p99.9, one in a thousand not
+static_assert(timeoutOf(histOf(1000, 1999, 20000000, 1)) ==
+              Latency::MIN_TIMEOUT_MS);
+static_assert(timeoutOf(histOf(1000, 999, 20000000, 1)) == 269);
+// clamped to the ceiling, and the last bucket takes everything beyond it
+static_assert(timeoutOf(histOf(100000000, 1000, 0, 0)) ==
+              Latency::MAX_TIMEOUT_MS);
+static_assert(histOf(~uint64_t(0), 1, 0, 0).percentile(1) ==
+              uint64_t(1) << (Histogram::BUCKETS - 1));
+
+uint32_t Latency::lineTimeoutMs(const ASTNode &node) {
+    if (const auto callee = calleeOf(node); callee != NO_SYMBOL) {
+        auto it = byCallee.find(callee);
+        if (it != byCallee.end() && it->second.samples >= MIN_SAMPLES)
+            return timeoutOf(it->second);
+    }
+    const auto &kind = byKind[static_cast<size_t>(node.kind)];
+    return kind.samples >= MIN_SAMPLES ? timeoutOf(kind) : MAX_TIMEOUT_MS;
+}
+
+uint32_t Latency::batchTimeoutMs(const std::vector<ASTNode> &nodes) {
+    uint32_t total = 0;
+    for (const auto &node : nodes) {
+        total += lineTimeoutMs(node);
+        if (total >= MAX_TIMEOUT_MS)
+            return MAX_TIMEOUT_MS;
+    }
+    return std::max(total, MIN_TIMEOUT_MS);
+}
+
+void Latency::record(const ASTNode &node, uint64_t ns, bool timedOut) {
+    if (timedOut)
+        ++timeoutCnt;
+    // the real time is unknown, only that it's longer
+    const auto sample = timedOut ? ns * 2 : ns;
+    auto &kind = byKind[static_cast<size_t>(node.kind)];
+    kind.add(sample);
+    kind.timeouts += timedOut;
+    if (const auto callee = calleeOf(node); callee != NO_SYMBOL) {
+        auto &hist = byCallee[callee];
+        hist.add(sample);
+        hist.timeouts += timedOut;
+    }
+}
+
+void Latency::logStats() {
+    for (size_t k = 0; k < KIND_CNT; ++k) {
+        const auto &hist = byKind[k];
+        if (!hist.samples)
+            continue;
+        INFO("Latency {}: {} lines, p50 {}us, p99.9 {}us, timeout {}ms, {} "
+             "timeouts",
+             nlohmann::json(static_cast<ASTNodeKind>(k)).get<std::string>(),
+             hist.samples, hist.percentile(0.5) / 1000,
+             hist.percentile(0.999) / 1000, timeoutOf(hist), hist.timeouts);
+    }
+    // slowest callees first
+    std::vector<std::pair<uint64_t, SymbolID>> slow;
+    for (const auto &[callee, hist] : byCallee)
+        if (hist.samples >= MIN_SAMPLES || hist.timeouts)
+            slow.emplace_back(hist.percentile(0.999), callee);
+    std::sort(slow.rbegin(), slow.rend());
+    slow.resize(std::min<size_t>(slow.size(), 20));
+    for (const auto &[p999, callee] : slow) {
+        const auto &hist = byCallee[callee];
+        INFO("Latency call {}: {} lines, p50 {}us, p99.9 {}us, timeout {}ms, "
+             "{} timeouts",
+             symbolName(callee), hist.samples, hist.percentile(0.5) / 1000,
+             p999 / 1000, timeoutOf(hist), hist.timeouts);
+    }
+}
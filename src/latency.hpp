@@ -0,0 +1,37 @@
+#ifndef LATENCY_HPP
+#define LATENCY_HPP
+
+#include "ast.hpp"
+#include <chrono>
+#include <cstdint>
+
+extern uint64_t timeoutCnt;
+
+namespace FuzzingAST::Latency {
+// Per-line timeouts learned from how long lines took so far. Execution times
+// go into log2 histograms per node kind and, for calls, per callee name. A
+// line gets SAFETY_FACTOR times the p99.9 of the most specific histogram with
+// MIN_SAMPLES samples, clamped to [MIN_TIMEOUT_MS, MAX_TIMEOUT_MS]. A
+// timed-out line is recorded at twice the time it ran, so a key whose lines
+// keep timing out raises its own timeout.
+constexpr uint32_t MIN_TIMEOUT_MS = 20;
+constexpr uint32_t MAX_TIMEOUT_MS = 600;
+constexpr uint64_t MIN_SAMPLES = 64;
+constexpr uint64_t SAFETY_FACTOR = 8;
+
+// monotonic time the samples are taken with
+inline uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+uint32_t lineTimeoutMs(const ASTNode &node);
+// sum of the line timeouts of a batch, clamped like a single line's
+uint32_t batchTimeoutMs(const std::vector<ASTNode> &nodes);
+void record(const ASTNode &node, uint64_t ns, bool timedOut);
+// per-kind and slowest callee histograms, the slow-input statistics
+void logStats();
+} // namespace FuzzingAST::Latency
+
+#endif // LATENCY_HPP
@@ -0,0 +1,259 @@
+#include "learned.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <charconv>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+using namespace FuzzingAST;
+
+// One record per line, tab separated, types by name and "-" for -1:
+//   erase <type> <prop> <callable 0|1>
+//   param <type> <prop> <idx> <param type>
+//   arity <type> <prop> <n>
+//   const <type> <prop>
+//   type  <type>
+//   unary <op> <type>
+//   binop <op> <type>
+// Each record is a single O_APPEND write, so -jobs workers can share a log.
+static int logFd = -1;
+
+// FNV-1a over the builtins as loaded, before anything learned is applied
+static uint64_t fingerprint(const BuiltinContext &ctx) {
+    uint64_t h = 14695981039346656037ull;
+    auto mix = [&h](std::string_view bytes) {
+        for (const char c : bytes) {
+            h ^= static_cast<uint8_t>(c);
+            h *= 1099511628211ull;
+        }
+        h ^= 0xff;
+        h *= 1099511628211ull;
+    };
+    for (const auto &type : ctx.types)
+        mix(type);
+    for (const auto &[tid, props] : ctx.builtinsProps) {
+        mix(std::to_string(tid));
+        for (const auto &prop : props) {
+            mix(prop.name);
+            mix(std::to_string(prop.type));
+            mix(std::to_string(prop.funcSig.paramTypes.size()));
+            mix(prop.isCallable ? "c" : "-");
+            mix(prop.isConst ? "k" : "-");
+        }
+    }
+    mix(std::to_string(ctx.ops.size()));
+    mix(std::to_string(ctx.unaryOps.size()));
+    return h;
+}
+
+static bool learnable(const BuiltinContext &ctx, TypeID tid) {
+    return tid == -1 ||
+           (tid >= 0 && static_cast<size_t>(tid) < ctx.builtinTypesCnt &&
+            static_cast<size_t>(tid) < ctx.types.size());
+}
+
+static std::string_view typeName(const BuiltinContext &ctx, TypeID tid) {
+    return tid == -1 ? "-" : std::string_view(ctx.types[tid]);
+}
+
+static TypeID typeByName(const BuiltinContext &ctx, std::string_view name) {
+    if (name == "-")
+        return -1;
+    for (size_t i = 0; i < ctx.builtinTypesCnt && i < ctx.types.size(); ++i)
+        if (ctx.types[i] == name)
+            return static_cast<TypeID>(i);
+    return -2;
+}
+
+static void record(std::initializer_list<std::string_view> fields) {
+    if (logFd == -1)
+        return;
+    std::string line;
+    for (const auto field : fields) {
+        line += field;
+        line += '\t';
+    }
+    line.back() = '\n';
+    if (write(logFd, line.data(), line.size()) !=
+        static_cast<ssize_t>(line.size()))
+        WARN("Failed to append to the learned builtins log");
+}
+
+static void dropFrom(std::vector<TypeID> &types, TypeID tid, bool all) {
+    if (all) {
+        std::erase(types, tid);
+    } else if (auto it = std::find(types.begin(), types.end(), tid);
+               it != types.end()) {
+        types.erase(it);
+    }
+}
+
+static size_t toSize(std::string_view text) {
+    size_t value = 0;
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+// applies one record, false if it doesn't fit the builtins
+static bool replay(BuiltinContext &ctx,
+                   const std::vector<std::string_view> &f) {
+    if (f.size() < 2)
+        return false;
+    const auto &kind = f[0];
+    if (kind == "unary" || kind == "binop") {
+        const auto op = toSize(f[1]);
+        const auto tid = f.size() > 2 ? typeByName(ctx, f[2]) : -2;
+        if (tid < 0)
+            return false;
+        if (kind == "unary") {
+            if (op >= ctx.unaryOps.size())
+                return false;
+            dropFrom(ctx.unaryOps[op], tid, false);
+            return true;
+        }
+        if (op >= ctx.ops.size())
+            return false;
+        auto &row = ctx.ops[op];
+        if (static_cast<size_t>(tid) < row.size())
+            row[tid].clear();
+        for (auto &compat : row)
+            dropFrom(compat, tid, true);
+        return true;
+    }
+
+    const auto tid = typeByName(ctx, f[1]);
+    if (tid == -2 || !ctx.builtinsProps.contains(tid))
+        return false;
+    if (kind == "type") {
+        ctx.builtinsProps.erase(tid);
+        return true;
+    }
+    if (f.size() < 3)
+        return false;
+    auto &props = ctx.builtinsProps[tid];
+    const std::string name(f[2]);
+    if (kind == "erase") {
+        const bool callable = f.size() > 3 && f[3] == "1";
+        auto it = props.findNamed(name, [callable](const PropInfo &prop) {
+            return !callable || prop.isCallable;
+        });
+        if (it == props.end())
+            return false;
+        props.erase(it);
+        return true;
+    }
+    if (kind == "const") {
+        auto it = props.findNamed(name);
+        if (it == props.end())
+            return false;
+        it->isConst = true;
+        return true;
+    }
+    if (kind == "param" && f.size() > 4) {
+        const auto idx = toSize(f[3]);
+        const auto type = typeByName(ctx, f[4]);
+        auto it = props.findNamed(name, [idx](const PropInfo &prop) {
+            return prop.isCallable && idx < prop.funcSig.paramTypes.size();
+        });
+        if (it == props.end() || type == -2)
+            return false;
+        it->funcSig.paramTypes[idx] = type;
+        return true;
+    }
+    if (kind == "arity" && f.size() > 3) {
+        auto it = props.findNamed(
+            name, [](const PropInfo &prop) { return prop.isCallable; });
+        if (it == props.end())
+            return false;
+        it->funcSig.paramTypes.resize(toSize(f[3]));
+        return true;
+    }
+    return false;
+}
+
+void Learned::load(BuiltinContext &ctx) {
+    fs::create_directories("corpus");
+    char build[17];
+    const auto end = std::to_chars(build, build + 16, fingerprint(ctx), 16).ptr;
+    const auto path =
+        "corpus/learned_" + std::string(build, end) + ".log";
+
+    size_t applied = 0, skipped = 0;
+    std::unordered_set<std::string> seen;
+    std::ifstream in(path);
+    std::vector<std::string_view> fields;
+    for (std::string line; std::getline(in, line);) {
+        if (line.empty())
+            continue;
+        // workers learning the same repair log it once each. param and arity
+        // overwrite, the last record wins and an earlier duplicate may not
+        if (!line.starts_with("param\t") && !line.starts_with("arity\t") &&
+            !seen.insert(line).second)
+            continue;
+        fields.clear();
+        for (size_t pos = 0;;) {
+            const auto tab = line.find('\t', pos);
+            fields.push_back(std::string_view(line).substr(pos, tab - pos));
+            if (tab == std::string::npos)
+                break;
+            pos = tab + 1;
+        }
+        if (replay(ctx, fields))
+            ++applied;
+        else
+            ++skipped;
+    }
+    ctx.invalidateIndex();
+    if (applied || skipped)
+        INFO("Replayed {} learned builtin repairs from {}, {} skipped",
+             applied, path, skipped);
+
+    logFd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                 0644);
+    if (logFd == -1)
+        WARN("Failed to open {}, builtin repairs won't be kept", path);
+}
+
+void Learned::eraseProp(const BuiltinContext &ctx, TypeID tid,
+                        std::string_view name, bool callable) {
+    if (learnable(ctx, tid))
+        record({"erase", typeName(ctx, tid), name, callable ? "1" : "0"});
+}
+
+void Learned::setParam(const BuiltinContext &ctx, TypeID tid,
+                       std::string_view name, size_t idx, TypeID type) {
+    if (learnable(ctx, tid) && learnable(ctx, type))
+        record({"param", typeName(ctx, tid), name, std::to_string(idx),
+                typeName(ctx, type)});
+}
+
+void Learned::setArity(const BuiltinContext &ctx, TypeID tid,
+                       std::string_view name, size_t n) {
+    if (learnable(ctx, tid))
+        record({"arity", typeName(ctx, tid), name, std::to_string(n)});
+}
+
+void Learned::setConst(const BuiltinContext &ctx, TypeID tid,
+                       std::string_view name) {
+    if (learnable(ctx, tid))
+        record({"const", typeName(ctx, tid), name});
+}
+
+void Learned::dropType(const BuiltinContext &ctx, TypeID tid) {
+    if (learnable(ctx, tid) && tid != -1)
+        record({"type", typeName(ctx, tid)});
+}
+
+void Learned::dropUnaryOp(const BuiltinContext &ctx, size_t op, TypeID tid) {
+    if (learnable(ctx, tid) && tid != -1)
+        record({"unary", std::to_string(op), typeName(ctx, tid)});
+}
+
+void Learned::dropBinaryOp(const BuiltinContext &ctx, size_t op, TypeID tid) {
+    if (learnable(ctx, tid) && tid != -1)
+        record({"binop", std::to_string(op), typeName(ctx, tid)});
+}
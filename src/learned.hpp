@@ -0,0 +1,35 @@
+#ifndef LEARNED_HPP
+#define LEARNED_HPP
+
+#include "ast.hpp"
+#include <string_view>
+
+namespace FuzzingAST::Learned {
+// Builtin repairs made by the error callbacks, appended to
+// corpus/learned_<build>.log so a restart doesn't have to learn them again.
+// <build> fingerprints the builtins as loaded, a changed builtins.json or
+// target starts a new log. Records name types and props instead of ids and
+// only builtin types (and -1) are kept, classProps belong to one AST.
+
+// open the log matching ctx and replay it, right after loadBuiltinsFuncs
+void load(BuiltinContext &ctx);
+
+// prop removed, callable restricts the match to callables
+void eraseProp(const BuiltinContext &ctx, TypeID tid, std::string_view name,
+               bool callable);
+// parameter idx of a callable set to type
+void setParam(const BuiltinContext &ctx, TypeID tid, std::string_view name,
+              size_t idx, TypeID type);
+// parameter list of a callable resized to n
+void setArity(const BuiltinContext &ctx, TypeID tid, std::string_view name,
+              size_t n);
+void setConst(const BuiltinContext &ctx, TypeID tid, std::string_view name);
+// every prop of a type removed
+void dropType(const BuiltinContext &ctx, TypeID tid);
+// type removed from ctx.unaryOps[op]
+void dropUnaryOp(const BuiltinContext &ctx, size_t op, TypeID tid);
+// type removed from ctx.ops[op], as left and as right operand
+void dropBinaryOp(const BuiltinContext &ctx, size_t op, TypeID tid);
+} // namespace FuzzingAST::Learned
+
+#endif // LEARNED_HPP
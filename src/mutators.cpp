@@ -1,13 +1,10 @@
 #include "mutators.hpp"
+#include "crash.hpp"
 #include "driver.hpp"
 #include "log.hpp"
-#include "serialization.hpp"
 
 using namespace FuzzingAST;
 
-extern std::string data_backup;
-extern std::string data_backup2;
-
 constexpr size_t NUM_MUTATE = 4;
 
 int FuzzingAST::generate_execution(ASTData &ast, BuiltinContext &ctx) {
@@ -27,13 +24,12 @@ int FuzzingAST::mutate_declaration(ASTData &astPtr, BuiltinContext &ctx) {
         // for each scope, mutate certain times
         for (auto i = 0; i < NUM_MUTATE; i++) {
             AST tmpAST;
+            CrashStateScope crashScope(tmpAST);
             do {
-                // TODO rn had to copy once, maybe it's able to just copy some
-                // parts
+                // cheap, tmpAST shares ast's chunks until it writes them
                 tmpAST = ast;
-                tmpAST = mutate_expression(tmpAST, sid, ctx);
-                data_backup = nlohmann::json(tmpAST).dump();
-                data_backup2.clear();
+                mutate_expression(tmpAST, sid, ctx);
+                journalAST(tmpAST);
             } while (reflectObject(tmpAST, tmpAST.scopes[sid], sid, ctx) != 0);
             ast = std::move(tmpAST);
         }
@@ -13,7 +13,8 @@ enum class MutationState { STATE_OK = 0, STATE_REROLL };
 
 int generate_execution_block(ASTData &ast, const ScopeID &scope,
                              BuiltinContext &ctx);
-AST mutate_expression(AST ast, const ScopeID scopeID, BuiltinContext &ctx);
+// mutates in place, only the chunks it writes to stop being shared
+void mutate_expression(AST &ast, const ScopeID scopeID, BuiltinContext &ctx);
 int generate_execution(ASTData &, BuiltinContext &ctx);
 int mutate_declaration(ASTData &, BuiltinContext &ctx);
 int generate_line(ASTNode &node, ASTData &ast, BuiltinContext &ctx,
@@ -56,8 +56,8 @@ static std::discrete_distribution<int> dist(PICK_MUTATION_WEIGHT.begin(),
 
 static std::uniform_int_distribution<int> distLib(0, TARGET_LIBS.size() - 1);
 
-AST FuzzingAST::mutate_expression(AST ast, const ScopeID sid,
-                                  BuiltinContext &ctx) {
+void FuzzingAST::mutate_expression(AST &ast, const ScopeID sid,
+                                   BuiltinContext &ctx) {
     size_t typesCnt;
     ScopeID parentScopeID;
     {
@@ -69,7 +69,13 @@ AST FuzzingAST::mutate_expression(AST ast, const ScopeID sid,
                 const auto &varInfoKey = ast.variables[cnt++];
                 const auto &varInfo = unfoldKey(varInfoKey, ast, ctx);
                 if (varInfo.type == ctx.strID) {
-                    havoc(std::get<std::string>(node.fields[1].val), 50);
+                    // owned, every round makes a new text
+                    auto &val = node.fields[1].val;
+                    auto text = std::holds_alternative<Literal>(val)
+                                    ? std::get<Literal>(val).str()
+                                    : std::get<Symbol>(val).str();
+                    havoc(text, 50);
+                    val = Literal(std::move(text));
                 } else if (varInfo.type == ctx.intID) {
                     static std::uniform_int_distribution<int64_t> pickNum(
                         0, INT64_MAX);
@@ -125,8 +131,9 @@ AST FuzzingAST::mutate_expression(AST ast, const ScopeID sid,
                     state = MutationState::STATE_REROLL;
                     break;
                 }
-                tid = resolveType(std::get<std::string>(clsNode.fields[1].val),
-                                  ctx, ast, sid);
+                tid = resolveType(
+                    std::get<Symbol>(clsNode.fields[1].val).str(), ctx, ast,
+                    sid);
             }
 
             const auto &pickedKey = ctx.pickRandomMethod(tid);
@@ -339,7 +346,7 @@ AST FuzzingAST::mutate_expression(AST ast, const ScopeID sid,
                             bool found = false;
                             for (const auto &declID : scope.declarations) {
                                 const auto &decl = ast.declarations[declID];
-                                if (std::get<std::string>(decl.fields[0].val) ==
+                                if (std::get<Symbol>(decl.fields[0].val) ==
                                     *it) {
                                     found = true;
                                     break;
@@ -368,7 +375,7 @@ AST FuzzingAST::mutate_expression(AST ast, const ScopeID sid,
                 ast.variables.emplace_back(NO_MODULE, ast.classProps[-1].size(),
                                            -1);
                 ast.classProps[-1].emplace_back(
-                    tid, sid, std::get<std::string>(var.fields[0].val));
+                    tid, sid, std::get<Symbol>(var.fields[0].val).str());
                 scope.declarations.push_back(varID);
             }
             ast.declarations.push_back(std::move(var));
@@ -387,5 +394,4 @@ AST FuzzingAST::mutate_expression(AST ast, const ScopeID sid,
         }
         } // switch
     }
-    return ast;
 }
\ No newline at end of file
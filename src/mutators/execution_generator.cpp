@@ -62,8 +62,9 @@ int FuzzingAST::generate_line(ASTNode &node, ASTData &ast, BuiltinContext &ctx,
                 break;
             }
             const auto &v1 = unfoldKey(v1Key, ast.ast, ctx);
-            auto v1Name = v1.name;
-            auto v2Name = unfoldKey(v2Key, ast.ast, ctx).name;
+            Symbol v1Name = v1.name;
+            const auto &v2 = unfoldKey(v2Key, ast.ast, ctx);
+            Symbol v2Name = v2.name;
             if (v1Key.parentType != -1) {
                 const auto v1pKey =
                     ctx.pickRandomVar(scopeID, v1Key.parentType, false);
@@ -72,7 +73,7 @@ int FuzzingAST::generate_line(ASTNode &node, ASTData &ast, BuiltinContext &ctx,
                     break;
                 }
                 const auto &v1p = unfoldKey(v1pKey, ast.ast, ctx);
-                v1Name = v1p.name + '.' + v1Name;
+                v1Name = Symbol(v1p.name, v1.name);
                 // globalVars.insert(v1pName);
                 insertGlobalVar(v1p, globalVars);
             } else
@@ -85,7 +86,7 @@ int FuzzingAST::generate_line(ASTNode &node, ASTData &ast, BuiltinContext &ctx,
                     state = MutationState::STATE_REROLL;
                     break;
                 }
-                v2Name = unfoldKey(v2pKey, ast.ast, ctx).name + '.' + v2Name;
+                v2Name = Symbol(unfoldKey(v2pKey, ast.ast, ctx).name, v2.name);
             }
 
             curr.fields = {{v1Name}, {v2Name}};
@@ -132,8 +133,8 @@ int FuzzingAST::generate_line(ASTNode &node, ASTData &ast, BuiltinContext &ctx,
                         }
                         const auto &parentVar =
                             unfoldKey(parentVarKey, ast.ast, ctx);
-                        curr.fields.emplace_back(parentVar.name + '.' +
-                                                 var.name);
+                        curr.fields.emplace_back(
+                            Symbol(parentVar.name, var.name));
                         // globalVars.insert(parentVar.name);
                         insertGlobalVar(parentVar, globalVars);
                     } else {
@@ -203,15 +204,14 @@ int FuzzingAST::generate_line(ASTNode &node, ASTData &ast, BuiltinContext &ctx,
                     // globalVars.insert(selfVar);
                     insertGlobalVar(selfVar, globalVars);
                     // xxx.yyy(...)
-                    curr.fields[1] = {selfVar.name + '.' + fname};
+                    curr.fields[1] = {Symbol(selfVar.name, fname)};
                     // or static usage: yyy(xxx, ...)
                     // curr.fields.push_back({selfVar});
                     i = 1;
                 } else {
                     // static method
-                    curr.fields[1] = {
-                        getTypeName(funcKey.parentType, ast.ast, ctx) + '.' +
-                        fname};
+                    curr.fields[1] = {Symbol(
+                        getTypeName(funcKey.parentType, ast.ast, ctx), fname)};
                 }
             }
 
@@ -225,7 +225,7 @@ int FuzzingAST::generate_line(ASTNode &node, ASTData &ast, BuiltinContext &ctx,
                     break;
                 }
                 const auto &paramVar = unfoldKey(paramVarKey, ast.ast, ctx);
-                auto pName = paramVar.name;
+                Symbol pName = paramVar.name;
                 if (paramVarKey.parentType != -1) {
                     // TODO false workaround
                     const auto parentVarKey = ctx.pickRandomVar(
@@ -235,7 +235,7 @@ int FuzzingAST::generate_line(ASTNode &node, ASTData &ast, BuiltinContext &ctx,
                         break;
                     }
                     const auto &p = unfoldKey(parentVarKey, ast.ast, ctx);
-                    pName = p.name + '.' + pName;
+                    pName = Symbol(p.name, paramVar.name);
                     insertGlobalVar(p, globalVars);
                 } else
                     insertGlobalVar(paramVar, globalVars);
@@ -361,7 +361,7 @@ int FuzzingAST::generate_line(ASTNode &node, ASTData &ast, BuiltinContext &ctx,
                 break;
             }
             const auto &container = unfoldKey(containerKey, ast.ast, ctx);
-            auto containerName = container.name;
+            Symbol containerName = container.name;
             if (containerKey.parentType != -1) {
                 const auto parentKey = ctx.pickRandomVar(
                     scopeID, containerKey.parentType, false);
@@ -370,8 +370,8 @@ int FuzzingAST::generate_line(ASTNode &node, ASTData &ast, BuiltinContext &ctx,
                     break;
                 }
                 containerName =
-                    unfoldKey(parentKey, ast.ast, ctx).name + '.' +
-                    containerName;
+                    Symbol(unfoldKey(parentKey, ast.ast, ctx).name,
+                           container.name);
             }
             insertGlobalVar(container, globalVars);
 
@@ -386,7 +386,7 @@ int FuzzingAST::generate_line(ASTNode &node, ASTData &ast, BuiltinContext &ctx,
                 break;
             }
             const auto &indexVar = unfoldKey(indexKey, ast.ast, ctx);
-            auto indexName = indexVar.name;
+            const auto &indexName = indexVar.name;
             insertGlobalVar(indexVar, globalVars);
 
             // Pick value: any type (triggers __index__ on bytearray assignment)
@@ -397,7 +397,7 @@ int FuzzingAST::generate_line(ASTNode &node, ASTData &ast, BuiltinContext &ctx,
                 break;
             }
             const auto &value = unfoldKey(valueKey, ast.ast, ctx);
-            auto valueName = value.name;
+            Symbol valueName = value.name;
             if (valueKey.parentType != -1) {
                 const auto parentKey = ctx.pickRandomVar(
                     scopeID, valueKey.parentType, false);
@@ -406,7 +406,7 @@ int FuzzingAST::generate_line(ASTNode &node, ASTData &ast, BuiltinContext &ctx,
                     break;
                 }
                 valueName =
-                    unfoldKey(parentKey, ast.ast, ctx).name + '.' + valueName;
+                    Symbol(unfoldKey(parentKey, ast.ast, ctx).name, value.name);
             }
             insertGlobalVar(value, globalVars);
 
@@ -439,7 +439,7 @@ int FuzzingAST::generate_line(ASTNode &node, ASTData &ast, BuiltinContext &ctx,
                 break;
             }
             const auto &container = unfoldKey(containerKey, ast.ast, ctx);
-            auto containerName = container.name;
+            Symbol containerName = container.name;
             if (containerKey.parentType != -1) {
                 const auto parentKey = ctx.pickRandomVar(
                     scopeID, containerKey.parentType, ctx.pickConst());
@@ -448,8 +448,8 @@ int FuzzingAST::generate_line(ASTNode &node, ASTData &ast, BuiltinContext &ctx,
                     break;
                 }
                 containerName =
-                    unfoldKey(parentKey, ast.ast, ctx).name + '.' +
-                    containerName;
+                    Symbol(unfoldKey(parentKey, ast.ast, ctx).name,
+                           container.name);
             }
             insertGlobalVar(container, globalVars);
 
@@ -464,7 +464,7 @@ int FuzzingAST::generate_line(ASTNode &node, ASTData &ast, BuiltinContext &ctx,
                 break;
             }
             const auto &indexVar = unfoldKey(indexKey, ast.ast, ctx);
-            auto indexName = indexVar.name;
+            const auto &indexName = indexVar.name;
             insertGlobalVar(indexVar, globalVars);
 
             // Create result variable (type=object, will be updated by runtime)
@@ -522,21 +522,17 @@ int FuzzingAST::generate_execution_block(ASTData &ast, const ScopeID &scopeID,
         }
     }
     if (scopeID != 0 && !globalVars.empty()) {
-        // filter out if varName is in scope variables
+        // filter out if varName is in scope variables, those are the
+        // classProps[-1] entries declared in this scope
+        const auto &vars = ast.ast.classProps[-1];
         for (auto it = globalVars.begin(); it != globalVars.end();) {
-            bool found = false;
-            for (VarID varID : scope.variables) {
-                const auto &varInfoKey = ast.ast.variables.at(varID);
-                const auto &varInfo = unfoldKey(varInfoKey, ast.ast, ctx);
-                if (varInfo.name == *it) {
-                    it = globalVars.erase(it);
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
+            auto var = vars.findNamed(*it, [scopeID](const PropInfo &info) {
+                return info.scope == scopeID;
+            });
+            if (var != vars.end())
+                it = globalVars.erase(it);
+            else
                 ++it;
-            }
         }
         if (!globalVars.empty()) {
             ASTNode globalVarsNode;
@@ -0,0 +1,132 @@
+#include "schedule.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace FuzzingAST;
+
+extern std::mt19937 rng;
+
+namespace {
+// the uniform pick of the original fallback
+class UniformPolicy : public SchedulePolicy {
+  public:
+    const char *name() const override { return "uniform"; }
+    size_t pick(const std::deque<ASTData> &corpus, uint64_t) override {
+        return rng() % corpus.size();
+    }
+};
+
+// favored and not yet evaluated entries, others get an occasional turn
+class FavoredPolicy : public SchedulePolicy {
+  public:
+    const char *name() const override { return "favored"; }
+    size_t pick(const std::deque<ASTData> &corpus, uint64_t) override {
+        std::vector<size_t> preferred;
+        for (size_t i = 0; i < corpus.size(); ++i) {
+            if (corpus[i].favored || corpus[i].edges.empty())
+                preferred.push_back(i);
+        }
+        if (preferred.empty() || rng() % 10 == 0)
+            return rng() % corpus.size();
+        return preferred[rng() % preferred.size()];
+    }
+};
+
+// AFLFast "fast": energy grows with recent yield, speed and small size and
+// shrinks with how often the entry was already picked, stale entries decay
+class FastPolicy : public SchedulePolicy {
+  public:
+    const char *name() const override { return "fast"; }
+    size_t pick(const std::deque<ASTData> &corpus, uint64_t round) override {
+        double meanNs = 0, meanSize = 0;
+        for (const auto &data : corpus) {
+            meanNs += avgRoundNs(data);
+            meanSize += entrySize(data);
+        }
+        meanNs /= corpus.size();
+        meanSize /= corpus.size();
+
+        std::vector<double> energy(corpus.size());
+        for (size_t i = 0; i < corpus.size(); ++i) {
+            const auto &data = corpus[i];
+            const auto &st = data.stats;
+            double e = data.favored ? 2.0 : 1.0;
+            e *= std::clamp(meanNs / std::max(avgRoundNs(data), 1.0), 0.25,
+                            4.0);
+            e *= std::clamp(meanSize / std::max(entrySize(data), 1.0), 0.25,
+                            4.0);
+            if (st.rounds > 0) {
+                // yield per round, halved every HALF_LIFE rounds since the
+                // last find
+                const double yield =
+                    static_cast<double>(st.foundEdges) / st.rounds;
+                const double age =
+                    static_cast<double>(round - st.lastFoundRound);
+                e *= 1.0 + yield * std::exp2(-age / HALF_LIFE);
+            } else {
+                // never run here, explore it
+                e *= 4.0;
+            }
+            energy[i] = e / std::exp2(std::min<uint32_t>(st.picks, 16));
+        }
+        std::discrete_distribution<size_t> dist(energy.begin(), energy.end());
+        return dist(rng);
+    }
+
+  private:
+    static constexpr double HALF_LIFE = 2000.0;
+    static double avgRoundNs(const ASTData &data) {
+        return data.stats.rounds
+                   ? static_cast<double>(data.stats.execNs) / data.stats.rounds
+                   : 0.0;
+    }
+    static double entrySize(const ASTData &data) {
+        return data.ast.declarations.size() + data.ast.expressions.size();
+    }
+};
+
+// UCB1 with "a generation round found new edges" as the reward
+class UCBPolicy : public SchedulePolicy {
+  public:
+    const char *name() const override { return "ucb"; }
+    size_t pick(const std::deque<ASTData> &corpus, uint64_t) override {
+        double total = 0;
+        for (const auto &data : corpus)
+            total += data.stats.rounds;
+        size_t best = 0;
+        double bestScore = -1;
+        for (size_t i = 0; i < corpus.size(); ++i) {
+            const auto &st = corpus[i].stats;
+            if (st.rounds == 0)
+                return i; // play every arm once
+            const double mean = static_cast<double>(st.yieldRounds) /
+                                st.rounds;
+            const double score =
+                mean + EXPLORATION * std::sqrt(std::log(total) / st.rounds);
+            if (score > bestScore) {
+                bestScore = score;
+                best = i;
+            }
+        }
+        return best;
+    }
+
+  private:
+    static constexpr double EXPLORATION = 1.4142135623730951; // sqrt(2)
+};
+} // namespace
+
+std::unique_ptr<SchedulePolicy>
+FuzzingAST::makeSchedulePolicy(const std::string &name) {
+    if (name == "favored")
+        return std::make_unique<FavoredPolicy>();
+    if (name == "uniform")
+        return std::make_unique<UniformPolicy>();
+    if (name == "fast")
+        return std::make_unique<FastPolicy>();
+    if (name == "ucb")
+        return std::make_unique<UCBPolicy>();
+    return nullptr;
+}
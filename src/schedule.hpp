@@ -0,0 +1,24 @@
+#ifndef SCHEDULE_HPP
+#define SCHEDULE_HPP
+
+#include "ast.hpp"
+#include <deque>
+#include <memory>
+#include <string>
+
+namespace FuzzingAST {
+// picks the corpus entry to continue with after a fallback
+class SchedulePolicy {
+  public:
+    virtual ~SchedulePolicy() = default;
+    virtual const char *name() const = 0;
+    // corpus is non-empty, round is the scheduler's generation round counter
+    virtual size_t pick(const std::deque<ASTData> &corpus, uint64_t round) = 0;
+};
+
+// "favored" (default), "uniform", "fast" (AFLFast-style power schedule) or
+// "ucb" (UCB1 bandit), nullptr for unknown names
+std::unique_ptr<SchedulePolicy> makeSchedulePolicy(const std::string &name);
+} // namespace FuzzingAST
+
+#endif // SCHEDULE_HPP
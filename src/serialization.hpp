@@ -10,7 +10,7 @@ inline void to_json(nlohmann::json &j, const ASTNodeValue &node) {
     j["t"] = node.val.index();
     switch (node.val.index()) {
     case 0:
-        j["v"] = std::get<std::string>(node.val);
+        j["v"] = std::get<Symbol>(node.val).str();
         break;
     case 1:
         j["v"] = std::get<int64_t>(node.val);
@@ -21,6 +21,9 @@ inline void to_json(nlohmann::json &j, const ASTNodeValue &node) {
     case 3:
         j["v"] = std::get<double>(node.val);
         break;
+    case 4:
+        j["v"] = std::get<Literal>(node.val).str();
+        break;
     };
 }
 
@@ -29,7 +32,7 @@ inline void from_json(const nlohmann::json &j, ASTNodeValue &node) {
     auto index = j.at("t").template get<size_t>();
     switch (index) {
     case 0:
-        node.val = j.at("v").template get<std::string>();
+        node.val = Symbol(j.at("v").template get<std::string>());
         break;
     case 1:
         node.val = j.at("v").template get<int64_t>();
@@ -40,12 +43,43 @@ inline void from_json(const nlohmann::json &j, ASTNodeValue &node) {
     case 3:
         node.val = j.at("v").template get<double>();
         break;
+    case 4:
+        node.val = Literal(j.at("v").template get<std::string>());
+        break;
 
     default:
         throw std::runtime_error("Invalid ASTNodeValue type");
     }
 }
 
+// stored as plain arrays, same format as the std::vector fields had
+template <typename T, size_t ChunkBits>
+void to_json(nlohmann::json &j, const CowVector<T, ChunkBits> &v) {
+    j = nlohmann::json::array();
+    for (const auto &x : v)
+        j.push_back(x);
+}
+
+template <typename T, size_t ChunkBits>
+void from_json(const nlohmann::json &j, CowVector<T, ChunkBits> &v) {
+    v = j.template get<std::vector<T>>();
+}
+
+// [[key, value], ...], what an int-keyed std::unordered_map produced
+template <typename T>
+void to_json(nlohmann::json &j, const TypeMap<T> &m) {
+    j = nlohmann::json::array();
+    for (const auto &[key, value] : m)
+        j.push_back(nlohmann::json::array({key, value}));
+}
+
+template <typename T>
+void from_json(const nlohmann::json &j, TypeMap<T> &m) {
+    m.clear();
+    for (const auto &kv : j)
+        kv.at(1).get_to(m[kv.at(0).template get<int>()]);
+}
+
 }; // namespace FuzzingAST
 
 namespace nlohmann {
@@ -81,6 +115,15 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(PropKey, moduleID, idx, parentType);
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(PropInfo, type, name,
                                                 isCallable, isConst, scope,
                                                 funcSig);
+
+inline void to_json(nlohmann::json &j, const PropList &props) {
+    j = props.props();
+}
+
+inline void from_json(const nlohmann::json &j, PropList &props) {
+    props = j.get<std::vector<PropInfo>>();
+}
+
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(ASTNode, kind, fields, scope);
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(ASTScope, declarations,
                                                 expressions, variables, types,
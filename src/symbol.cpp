@@ -0,0 +1,88 @@
+#include "symbol.hpp"
+#include <cctype>
+#include <deque>
+#include <unordered_map>
+
+using namespace FuzzingAST;
+
+namespace {
+struct SymbolTable {
+    // deque keeps the strings in place, the index points into them
+    std::deque<std::string> names{""};
+    std::unordered_map<std::string_view, SymbolID> index{{names[0], 0}};
+};
+
+SymbolTable &table() {
+    static SymbolTable t;
+    return t;
+}
+
+bool isIdentStart(char c) {
+    return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool isIdentifier(std::string_view s) {
+    if (s.empty() || !isIdentStart(s[0]))
+        return false;
+    for (char c : s)
+        if (!isIdentStart(c) && !std::isdigit(static_cast<unsigned char>(c)))
+            return false;
+    return true;
+}
+} // namespace
+
+SymbolID FuzzingAST::internSymbol(std::string_view text) {
+    auto &t = table();
+    auto it = t.index.find(text);
+    if (it != t.index.end())
+        return it->second;
+    const auto id = static_cast<SymbolID>(t.names.size());
+    t.index.emplace(t.names.emplace_back(text), id);
+    return id;
+}
+
+SymbolID FuzzingAST::findSymbol(std::string_view text) {
+    const auto &index = table().index;
+    auto it = index.find(text);
+    return it == index.end() ? NO_SYMBOL : it->second;
+}
+
+const std::string &FuzzingAST::symbolName(SymbolID id) {
+    return table().names[id];
+}
+
+Symbol::Symbol(std::string_view text) {
+    // split `<name...>.<identifier>`, literals and calls stay whole
+    const auto dot = text.rfind('.');
+    if (dot != std::string_view::npos && dot > 0 && isIdentStart(text[0]) &&
+        isIdentifier(text.substr(dot + 1))) {
+        base = internSymbol(text.substr(0, dot));
+        attr = internSymbol(text.substr(dot + 1));
+    } else {
+        base = internSymbol(text);
+    }
+}
+
+void Symbol::appendTo(std::string &out) const {
+    out += symbolName(base);
+    if (dotted()) {
+        out += '.';
+        out += symbolName(attr);
+    }
+}
+
+std::string Symbol::str() const {
+    std::string out;
+    appendTo(out);
+    return out;
+}
+
+bool Symbol::operator==(std::string_view text) const {
+    const auto &obj = symbolName(base);
+    if (!dotted())
+        return text == obj;
+    const auto &member = symbolName(attr);
+    return text.size() == obj.size() + 1 + member.size() &&
+           text.starts_with(obj) && text[obj.size()] == '.' &&
+           text.ends_with(member);
+}
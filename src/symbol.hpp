@@ -0,0 +1,99 @@
+#ifndef SYMBOL_HPP
+#define SYMBOL_HPP
+
+#include "codebuf.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace FuzzingAST {
+// Identifiers and source snippets held by AST nodes are interned once per
+// process, nodes keep 4-byte ids so copying an AST doesn't copy strings.
+// Ids are only meaningful inside the process, files store the text.
+using SymbolID = uint32_t;
+constexpr SymbolID NO_SYMBOL = static_cast<SymbolID>(-1);
+constexpr SymbolID EMPTY_SYMBOL = 0; // ""
+
+SymbolID internSymbol(std::string_view text);
+// NO_SYMBOL if text was never interned
+SymbolID findSymbol(std::string_view text);
+const std::string &symbolName(SymbolID id);
+
+// node string field, `obj.attr` accesses are kept as an (object, attribute)
+// pair, everything else is a single interned text
+class Symbol {
+  public:
+    Symbol() = default;
+    Symbol(std::string_view text);
+    Symbol(const std::string &text) : Symbol(std::string_view(text)) {}
+    Symbol(const char *text) : Symbol(std::string_view(text)) {}
+    Symbol(std::string_view obj, std::string_view attr)
+        : base(internSymbol(obj)), attr(internSymbol(attr)) {}
+
+    bool empty() const { return base == EMPTY_SYMBOL && attr == NO_SYMBOL; }
+    bool dotted() const { return attr != NO_SYMBOL; }
+    // the object part alone, the whole text unless dotted
+    const std::string &name() const { return symbolName(base); }
+    void appendTo(std::string &out) const;
+    std::string str() const;
+
+    bool operator==(const Symbol &) const = default;
+    bool operator==(std::string_view text) const;
+    bool operator==(const std::string &text) const {
+        return *this == std::string_view(text);
+    }
+    bool operator==(const char *text) const {
+        return *this == std::string_view(text);
+    }
+
+    SymbolID base = EMPTY_SYMBOL;
+    SymbolID attr = NO_SYMBOL;
+};
+
+inline CodeBuffer &operator<<(CodeBuffer &out, const Symbol &sym) {
+    out << symbolName(sym.base);
+    if (sym.dotted())
+        out << '.' << symbolName(sym.attr);
+    return out;
+}
+
+// node text owned by the node instead of interned, for literals that are
+// rewritten rather than reused like havoc'd strings. AST copies share it and
+// it is freed with the last one, interned it would live for the whole run
+class Literal {
+  public:
+    Literal() = default;
+    explicit Literal(std::string text)
+        : text_(std::make_shared<const std::string>(std::move(text))) {}
+
+    const std::string &str() const {
+        return text_ ? *text_ : symbolName(EMPTY_SYMBOL);
+    }
+    bool operator==(const Literal &other) const {
+        return str() == other.str();
+    }
+
+  private:
+    std::shared_ptr<const std::string> text_;
+};
+
+inline CodeBuffer &operator<<(CodeBuffer &out, const Literal &lit) {
+    return out << lit.str();
+}
+} // namespace FuzzingAST
+
+template <> struct std::hash<FuzzingAST::Symbol> {
+    size_t operator()(const FuzzingAST::Symbol &sym) const noexcept {
+        return (static_cast<size_t>(sym.base) << 32) | sym.attr;
+    }
+};
+
+template <> struct std::hash<FuzzingAST::Literal> {
+    size_t operator()(const FuzzingAST::Literal &lit) const noexcept {
+        return std::hash<std::string>()(lit.str());
+    }
+};
+
+#endif // SYMBOL_HPP
@@ -0,0 +1,148 @@
+#ifndef TYPEMAP_HPP
+#define TYPEMAP_HPP
+
+#include <bit>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace FuzzingAST {
+// Map keyed by a small integer id (TypeID, ModuleID). Lookups probe a flat
+// open-addressing table of entry indices, no node chasing. Entries live in a
+// deque so references survive inserting other keys, erase() moves the last
+// entry into the hole and so invalidates references to that one as well.
+template <typename T> class TypeMap {
+    using Key = int;
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+  public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using iterator = typename std::deque<value_type>::iterator;
+    using const_iterator = typename std::deque<value_type>::const_iterator;
+
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+    iterator begin() { return entries_.begin(); }
+    iterator end() { return entries_.end(); }
+    const_iterator begin() const { return entries_.begin(); }
+    const_iterator end() const { return entries_.end(); }
+
+    iterator find(Key key) {
+        const auto slot = findSlot(key);
+        return slot == EMPTY ? end() : begin() + slots_[slot];
+    }
+    const_iterator find(Key key) const {
+        const auto slot = findSlot(key);
+        return slot == EMPTY ? end() : begin() + slots_[slot];
+    }
+    bool contains(Key key) const { return findSlot(key) != EMPTY; }
+
+    T &at(Key key) {
+        const auto slot = findSlot(key);
+        if (slot == EMPTY)
+            throw std::out_of_range("TypeMap::at");
+        return entries_[slots_[slot]].second;
+    }
+    const T &at(Key key) const {
+        const auto slot = findSlot(key);
+        if (slot == EMPTY)
+            throw std::out_of_range("TypeMap::at");
+        return entries_[slots_[slot]].second;
+    }
+    T &operator[](Key key) { return try_emplace(key).first->second; }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(Key key, Args &&...args) {
+        if (const auto slot = findSlot(key); slot != EMPTY)
+            return {begin() + slots_[slot], false};
+        if ((entries_.size() + 1) * 2 > slots_.size())
+            rehash(slots_.empty() ? 8 : slots_.size() * 2);
+        auto i = home(key);
+        while (slots_[i] != EMPTY)
+            i = (i + 1) & mask();
+        slots_[i] = static_cast<uint32_t>(entries_.size());
+        entries_.emplace_back(std::piecewise_construct,
+                              std::forward_as_tuple(key),
+                              std::forward_as_tuple(std::forward<Args>(args)...));
+        return {std::prev(end()), true};
+    }
+    template <typename V> std::pair<iterator, bool> emplace(Key key, V &&v) {
+        return try_emplace(key, std::forward<V>(v));
+    }
+
+    size_t erase(Key key) {
+        auto hole = findSlot(key);
+        if (hole == EMPTY)
+            return 0;
+        const auto idx = slots_[hole];
+        // backward-shift deletion keeps probe chains intact
+        for (auto j = (hole + 1) & mask(); slots_[j] != EMPTY;
+             j = (j + 1) & mask()) {
+            const auto want = home(entries_[slots_[j]].first);
+            if (((j - want) & mask()) >= ((j - hole) & mask())) {
+                slots_[hole] = slots_[j];
+                hole = j;
+            }
+        }
+        slots_[hole] = EMPTY;
+
+        const auto last = static_cast<uint32_t>(entries_.size() - 1);
+        if (idx != last) {
+            auto slot = home(entries_[last].first);
+            while (slots_[slot] != last)
+                slot = (slot + 1) & mask();
+            slots_[slot] = idx;
+            entries_[idx] = std::move(entries_[last]);
+        }
+        entries_.pop_back();
+        return 1;
+    }
+    void clear() {
+        entries_.clear();
+        slots_.clear();
+    }
+    void swap(TypeMap &other) noexcept {
+        entries_.swap(other.entries_);
+        slots_.swap(other.slots_);
+        std::swap(shift_, other.shift_);
+    }
+
+  private:
+    uint32_t mask() const { return static_cast<uint32_t>(slots_.size() - 1); }
+    uint32_t home(Key key) const {
+        // fibonacci hashing, the high bits mix in every bit of the key
+        return (static_cast<uint32_t>(key) * 2654435769u) >> shift_;
+    }
+    // slot holding key, EMPTY if absent
+    uint32_t findSlot(Key key) const {
+        if (slots_.empty())
+            return EMPTY;
+        for (auto i = home(key); slots_[i] != EMPTY; i = (i + 1) & mask())
+            if (entries_[slots_[i]].first == key)
+                return i;
+        return EMPTY;
+    }
+    void rehash(size_t capacity) {
+        slots_.assign(capacity, EMPTY);
+        shift_ = 32 - std::countr_zero(capacity);
+        for (uint32_t idx = 0; idx < entries_.size(); ++idx) {
+            auto i = home(entries_[idx].first);
+            while (slots_[i] != EMPTY)
+                i = (i + 1) & mask();
+            slots_[i] = idx;
+        }
+    }
+
+    std::deque<value_type> entries_;
+    std::vector<uint32_t> slots_; // power of two, at most half full
+    int shift_ = 32;
+};
+} // namespace FuzzingAST
+
+#endif // TYPEMAP_HPP
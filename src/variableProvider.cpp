@@ -1,193 +1,347 @@
 #include "ast.hpp"
+#include <algorithm>
 #include <random>
+#ifdef INDEX_CONSISTENCY_CHECK
+#include "log.hpp"
+#include <map>
+#include <tuple>
+#endif
 
 extern std::mt19937 rng;
 
 using namespace FuzzingAST;
 
-void BuiltinContext::updateVars(const AST &ast) {
-    size_t n = ast.scopes.size();
-    mutableIndex_.assign(n, {});
-    constIndex_.assign(n, {});
-    typeList_.assign(n, {});
-    typeDist_.assign(n, {});
-    varDist_.assign(n, {});
-
-    for (size_t i = 0; i < n; ++i) {
-        if (int p = ast.scopes[i].parent; p != -1) {
-            mutableIndex_[i] = mutableIndex_[p];
-            constIndex_[i] = constIndex_[p];
-        }
+static uint64_t userKey(TypeID tid, size_t idx) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(tid)) << 32) | idx;
+}
+
+static size_t pickBelow(size_t n) {
+    return std::uniform_int_distribution<size_t>(0, n - 1)(rng);
+}
 
-        for (const auto &[tid, pis] : ast.classProps) {
-            for (size_t j = 0; j < pis.size(); ++j) {
-                const auto &pi = pis[j];
-                if (pi.scope > static_cast<ScopeID>(i))
-                    continue;
+template <typename Map> static size_t countOf(const Map &vars, TypeID type) {
+    auto it = vars.find(type);
+    if (it == vars.end())
+        return 0;
+    if constexpr (requires { it->second.keys; })
+        return it->second.keys.size();
+    else
+        return it->second.size();
+}
+
+void BuiltinContext::Bucket::add(const PropKey &key) {
+    pos[userKey(key.parentType, key.idx)] = keys.size();
+    keys.push_back(key);
+}
 
-                auto &index = pi.isConst ? constIndex_ : mutableIndex_;
-                index[i][pi.type].emplace_back(NO_MODULE, j, tid);
-                index[i][0].emplace_back(NO_MODULE, j, tid); // fallback
+void BuiltinContext::Bucket::remove(TypeID tid, size_t idx) {
+    auto it = pos.find(userKey(tid, idx));
+    const size_t at = it->second;
+    pos.erase(it);
+    if (at + 1 != keys.size()) {
+        keys[at] = keys.back();
+        pos[userKey(keys[at].parentType, keys[at].idx)] = at;
+    }
+    keys.pop_back();
+}
+
+void BuiltinContext::update(const AST &ast) {
+    if (!indexValid_) {
+        builtinLayer_ = buildLayer(BUILTIN_MODULE_ID, builtinsProps);
+        moduleLayers_.clear();
+    }
+    const bool modulesChanged =
+        !indexValid_ || ast.importedModules != indexedModules_;
+    if (modulesChanged)
+        useModules(ast.importedModules);
+
+    if (!indexValid_ || userIndexStale(ast)) {
+        rebuildUserIndex(ast);
+        indexValid_ = true;
+    } else {
+        if (modulesChanged) {
+            refreshSharedTypes();
+            for (auto &s : scopes_) {
+                s.extraTypes.clear();
+                for (const auto &[tid, _] : s.mutableVars)
+                    refreshType(s, tid);
             }
         }
 
-        for (const auto &kv : builtinsProps) {
-            TypeID parentType = kv.first;
-            const auto &pis = kv.second;
-            for (size_t j = 0; j < pis.size(); ++j) {
-                const auto &pi = pis[j];
-                // Skip callable entries in the function index
-                if (pi.isCallable)
-                    continue;
-                auto &index = pi.isConst ? constIndex_ : mutableIndex_;
-                index[i][pi.type].emplace_back(BUILTIN_MODULE_ID, j,
-                                               parentType);
-                index[i][0].emplace_back(BUILTIN_MODULE_ID, j,
-                                         parentType); // fallback
-            }
+        // a new scope sees everything the previous one does plus the props
+        // declared in it
+        for (size_t i = scopes_.size(); i < ast.scopes.size(); ++i) {
+            scopes_.push_back(scopes_.back());
+            for (const auto &[tid, props] : indexedProps_)
+                for (size_t j = 0; j < props.size(); ++j)
+                    if (props[j].scope == static_cast<ScopeID>(i))
+                        indexProp(scopes_[i], tid, j, props[j], true);
         }
 
-        for (auto mid : ast.importedModules) {
-            for (const auto &kv : modulesProps[mid]) {
-                TypeID parentType = kv.first;
-                const auto &pis = kv.second;
-                for (size_t j = 0; j < pis.size(); ++j) {
-                    const auto &pi = pis[j];
-                    // Skip callable module entries - same rationale as builtins
-                    if (pi.isCallable)
+        for (const auto &[tid, props] : ast.classProps) {
+            auto [it, added] = indexedProps_.try_emplace(tid);
+            auto &seen = it->second;
+            const auto seenCnt = seen.size();
+            if (added) {
+                // its vars become pickable as a type
+                if (sharedCount(false, tid) &&
+                    std::find(sharedTypes_.begin(), sharedTypes_.end(),
+                              tid) == sharedTypes_.end())
+                    sharedTypes_.push_back(tid);
+                for (auto &s : scopes_)
+                    refreshType(s, tid);
+            }
+            for (size_t j = 0; j < props.size(); ++j) {
+                const auto &pi = props[j];
+                const IndexedProp cur{pi.type, pi.scope, pi.isConst,
+                                      pi.isCallable};
+                if (j < seen.size()) {
+                    if (seen[j] == cur)
                         continue;
-                    auto &index = pi.isConst ? constIndex_ : mutableIndex_;
-                    index[i][pi.type].emplace_back(mid, j, parentType);
-                    index[i][0].emplace_back(mid, j,
-                                             parentType); // fallback
+                    indexProp(tid, j, seen[j], false);
+                    seen[j] = cur;
+                } else {
+                    seen.push_back(cur);
                 }
+                indexProp(tid, j, cur, true);
             }
+            if (added || seenCnt != seen.size())
+                refreshMethods(tid, seen.size());
         }
+    }
+#ifdef INDEX_CONSISTENCY_CHECK
+    checkIndex(ast);
+#endif
+}
 
-        auto &types = typeList_[i];
-        for (const auto &kv : mutableIndex_[i]) {
-            // only interested with those types can be interacted with
-            if (!builtinsProps.contains(kv.first) &&
-                !ast.classProps.contains(kv.first))
+BuiltinContext::SharedLayer
+BuiltinContext::buildLayer(ModuleID mid,
+                           const TypeMap<PropList> &props) const {
+    SharedLayer layer;
+    for (const auto &[tid, pis] : props) {
+        for (size_t j = 0; j < pis.size(); ++j) {
+            const auto &pi = pis[j];
+            if (pi.isCallable) {
+                layer.funcs.emplace_back(mid, j, tid);
                 continue;
-            if (!kv.second.empty())
-                types.push_back(kv.first);
-        }
-        if (!types.empty()) {
-            typeDist_[i] =
-                std::uniform_int_distribution<size_t>(0, types.size() - 1);
-            for (auto t : types) {
-                varDist_[i][t] = {std::uniform_int_distribution<size_t>(
-                                      0, mutableIndex_[i][t].size() - 1),
-                                  std::uniform_int_distribution<size_t>(
-                                      0, constIndex_[i][t].size() - 1)};
             }
+            auto &vars = pi.isConst ? layer.constVars : layer.mutableVars;
+            vars[pi.type].emplace_back(mid, j, tid);
+            if (pi.type != 0)
+                vars[0].emplace_back(mid, j, tid); // fallback
         }
     }
+    return layer;
 }
 
-/*------------------ updateFuncs ------------------*/
-void BuiltinContext::updateFuncs(const AST &ast) {
-    size_t n = ast.scopes.size();
-    funcList_.assign(n, {});
-    funcDist_.assign(n, {});
-    funcCnts_.assign(n, 0);
-    methodDist_.clear();
+void BuiltinContext::useModules(const std::unordered_set<ModuleID> &modules) {
+    indexedModules_ = modules;
+    shared_.assign(1, &builtinLayer_);
+    for (auto mid : modules) {
+        // a module's props never change, its layer is built once
+        auto [it, added] = moduleLayers_.try_emplace(mid);
+        if (added)
+            it->second = buildLayer(mid, modulesProps[mid]);
+        shared_.push_back(&it->second);
+    }
+}
 
-    for (auto &[tid, props] : builtinsProps) {
-        if (methodDist_.find(tid) == methodDist_.end()) {
-            size_t s = props.size();
-            if (ast.classProps.contains(tid))
-                s += ast.classProps.at(tid).size();
-            if (s)
-                methodDist_.emplace(
-                    tid, std::uniform_int_distribution<size_t>(0, s - 1));
-        }
+bool BuiltinContext::userIndexStale(const AST &ast) const {
+    if (scopes_.empty() || ast.scopes.size() < scopes_.size())
+        return true;
+    // removed props shift the indices of the ones behind them
+    for (const auto &[tid, seen] : indexedProps_) {
+        auto it = ast.classProps.find(tid);
+        if (it == ast.classProps.end() || it->second.size() < seen.size())
+            return true;
     }
+    return false;
+}
 
+void BuiltinContext::rebuildUserIndex(const AST &ast) {
+    indexedProps_.clear();
     for (const auto &[tid, props] : ast.classProps) {
-        if (methodDist_.contains(tid))
-            continue; // already added in builtinsProps
-        size_t s = props.size();
-        if (s)
-            methodDist_.emplace(
-                tid, std::uniform_int_distribution<size_t>(0, s - 1));
+        auto &seen = indexedProps_[tid];
+        for (const auto &pi : props)
+            seen.push_back({pi.type, pi.scope, pi.isConst, pi.isCallable});
     }
+    refreshSharedTypes();
 
-    for (size_t i = 0; i < n; ++i) {
-        std::vector<PropKey> cands;
-        cands.reserve(128);
-
-        for (auto &kv : ast.classProps) {
-            TypeID tid = kv.first;
-            auto &vec = kv.second;
-            for (size_t j = 0; j < vec.size(); ++j) {
-                const auto &pi = vec[j];
-                if (pi.isCallable && pi.scope <= (ScopeID)i) {
-                    cands.emplace_back(NO_MODULE, j, tid);
-                }
-            }
-        }
+    scopes_.assign(ast.scopes.size(), {});
+    for (const auto &[tid, seen] : indexedProps_)
+        for (size_t j = 0; j < seen.size(); ++j)
+            indexProp(tid, j, seen[j], true);
 
-        for (auto &kv : builtinsProps) {
-            TypeID tid = kv.first;
-            auto &vec = kv.second;
-            for (size_t j = 0; j < vec.size(); ++j) {
-                if (vec[j].isCallable) {
-                    cands.emplace_back(BUILTIN_MODULE_ID, j, tid);
-                }
-            }
-        }
+    methodDist_.clear();
+    for (const auto &[tid, _] : builtinsProps) {
+        auto it = indexedProps_.find(tid);
+        refreshMethods(tid, it == indexedProps_.end() ? 0 : it->second.size());
+    }
+    for (const auto &[tid, seen] : indexedProps_)
+        refreshMethods(tid, seen.size());
+}
 
-        for (const auto &mid : ast.importedModules) {
-            for (auto &kv : modulesProps[mid]) {
-                TypeID tid = kv.first;
-                auto &vec = kv.second;
-                for (size_t j = 0; j < vec.size(); ++j) {
-                    if (vec[j].isCallable) {
-                        cands.emplace_back(mid, j, tid);
-                    }
-                }
-            }
-        }
+void BuiltinContext::indexProp(ScopeIndex &s, TypeID tid, size_t idx,
+                               const IndexedProp &prop, bool add) {
+    auto &vars = prop.isConst ? s.constVars : s.mutableVars;
+    if (add) {
+        vars[prop.type].add({NO_MODULE, idx, tid});
+        if (prop.type != 0)
+            vars[0].add({NO_MODULE, idx, tid}); // fallback
+    } else {
+        vars[prop.type].remove(tid, idx);
+        if (prop.type != 0)
+            vars[0].remove(tid, idx);
+    }
+    refreshType(s, prop.type);
+    refreshType(s, 0);
 
-        funcList_[i] = std::move(cands);
-        funcCnts_[i] = funcList_[i].size();
-        if (funcCnts_[i] > 0) {
-            funcDist_[i] =
-                std::uniform_int_distribution<size_t>(0, funcCnts_[i] - 1);
-        }
+    if (prop.isCallable) {
+        if (add)
+            s.funcs.add({NO_MODULE, idx, tid});
+        else
+            s.funcs.remove(tid, idx);
     }
 }
 
+void BuiltinContext::indexProp(TypeID tid, size_t idx, const IndexedProp &prop,
+                               bool add) {
+    for (size_t i = std::max(prop.scope, 0); i < scopes_.size(); ++i)
+        indexProp(scopes_[i], tid, idx, prop, add);
+}
+
+// only interested with those types can be interacted with
+bool BuiltinContext::interactable(TypeID type) const {
+    return builtinsProps.contains(type) || indexedProps_.contains(type);
+}
+
+size_t BuiltinContext::sharedCount(bool isConst, TypeID type) const {
+    size_t cnt = 0;
+    for (const auto *layer : shared_)
+        cnt += countOf(isConst ? layer->constVars : layer->mutableVars, type);
+    return cnt;
+}
+
+void BuiltinContext::refreshSharedTypes() {
+    sharedTypes_.clear();
+    for (const auto *layer : shared_)
+        for (const auto &[tid, keys] : layer->mutableVars)
+            if (!keys.empty() && interactable(tid) &&
+                std::find(sharedTypes_.begin(), sharedTypes_.end(), tid) ==
+                    sharedTypes_.end())
+                sharedTypes_.push_back(tid);
+}
+
+void BuiltinContext::refreshType(ScopeIndex &s, TypeID type) {
+    const bool extra = countOf(s.mutableVars, type) && interactable(type) &&
+                       !sharedCount(false, type);
+    auto it = std::find(s.extraTypes.begin(), s.extraTypes.end(), type);
+    if (extra && it == s.extraTypes.end())
+        s.extraTypes.push_back(type);
+    else if (!extra && it != s.extraTypes.end())
+        s.extraTypes.erase(it);
+}
+
+void BuiltinContext::refreshMethods(TypeID tid, size_t classSize) {
+    size_t cnt = classSize;
+    if (auto it = builtinsProps.find(tid); it != builtinsProps.end())
+        cnt += it->second.size();
+    if (cnt)
+        methodDist_[tid] = std::uniform_int_distribution<size_t>(0, cnt - 1);
+    else
+        methodDist_.erase(tid);
+}
+
+#ifdef INDEX_CONSISTENCY_CHECK
+// compare against a full rebuild, order inside buckets doesn't matter
+void BuiltinContext::checkIndex(const AST &ast) const {
+    BuiltinContext fresh = *this;
+    fresh.builtinLayer_ = buildLayer(BUILTIN_MODULE_ID, builtinsProps);
+    fresh.moduleLayers_.clear();
+    fresh.useModules(ast.importedModules);
+    fresh.rebuildUserIndex(ast);
+
+    using Keys = std::vector<std::tuple<ModuleID, size_t, TypeID>>;
+    auto add = [](Keys &out, const std::vector<PropKey> &keys) {
+        for (const auto &k : keys)
+            out.emplace_back(k.moduleID, k.idx, k.parentType);
+    };
+    // everything a scope can pick from, layers merged
+    auto view = [&add](const BuiltinContext &ctx, size_t i, bool isConst) {
+        std::map<TypeID, Keys> vars;
+        Keys funcs;
+        std::vector<TypeID> types = ctx.sharedTypes_;
+        for (const auto *layer : ctx.shared_) {
+            for (const auto &[tid, keys] :
+                 isConst ? layer->constVars : layer->mutableVars)
+                add(vars[tid], keys);
+            add(funcs, layer->funcs);
+        }
+        const auto &s = ctx.scopes_[i];
+        for (const auto &[tid, bucket] : isConst ? s.constVars : s.mutableVars)
+            add(vars[tid], bucket.keys);
+        add(funcs, s.funcs.keys);
+        types.insert(types.end(), s.extraTypes.begin(), s.extraTypes.end());
+
+        std::erase_if(vars, [](const auto &kv) { return kv.second.empty(); });
+        for (auto &[_, keys] : vars)
+            std::sort(keys.begin(), keys.end());
+        std::sort(funcs.begin(), funcs.end());
+        std::sort(types.begin(), types.end());
+        return std::make_tuple(vars, funcs, types);
+    };
+
+    if (scopes_.size() != fresh.scopes_.size())
+        PANIC("index has {} scopes, expected {}", scopes_.size(),
+              fresh.scopes_.size());
+    for (size_t i = 0; i < scopes_.size(); ++i)
+        for (bool isConst : {false, true})
+            if (view(*this, i, isConst) != view(fresh, i, isConst))
+                PANIC("variable index of scope {} out of sync", i);
+    for (const auto &[tid, dist] : fresh.methodDist_)
+        if (!methodDist_.contains(tid) || methodDist_.at(tid).b() != dist.b())
+            PANIC("method distribution of type {} out of sync", tid);
+    if (methodDist_.size() != fresh.methodDist_.size())
+        PANIC("method index has {} types, expected {}", methodDist_.size(),
+              fresh.methodDist_.size());
+}
+#endif
+
 /*------------------ pickRandomVar ------------------*/
 TypeID BuiltinContext::pickRandomType(ScopeID scopeID) {
-    const auto &types = typeList_[scopeID];
-    if (types.empty())
+    const auto &extra = scopes_[scopeID].extraTypes;
+    const size_t cnt = sharedTypes_.size() + extra.size();
+    if (cnt == 0)
         return 0;
-    return types[typeDist_[scopeID](rng)];
+    const size_t pick = pickBelow(cnt);
+    return pick < sharedTypes_.size() ? sharedTypes_[pick]
+                                      : extra[pick - sharedTypes_.size()];
 }
 
 PropKey BuiltinContext::pickRandomVar(ScopeID scopeID, TypeID type,
                                       bool isConst) {
-    const auto &mp = (isConst ? constIndex_ : mutableIndex_).at(scopeID);
-    // if (type == 0) {
-    //     if (mp.empty())
-    //         return PropKey::emptyKey();
-    //     type = pickRandomType(scopeID);
-    //     if (type == 0)
-    //         return PropKey::emptyKey();
-    // }
-
-    auto mit = mp.find(type);
-    if (mit == mp.end() || mit->second.empty())
-        return PropKey::emptyKey();
-    auto &scopeList = varDist_.at(scopeID);
-    auto typeList = scopeList.find(type);
-    if (typeList == scopeList.end())
+    const auto &s = scopes_.at(scopeID);
+    // the type has to be pickable in this scope, even for const vars
+    if (!interactable(type) ||
+        !(sharedCount(false, type) || countOf(s.mutableVars, type)))
         return PropKey::emptyKey();
 
-    return mit->second.at(typeList->second.at(isConst)(rng));
+    // sample across the shared layers and the scope's own vars by weight
+    const auto &own = isConst ? s.constVars : s.mutableVars;
+    const size_t cnt = sharedCount(isConst, type) + countOf(own, type);
+    if (cnt == 0)
+        return PropKey::emptyKey();
+    size_t pick = pickBelow(cnt);
+    for (const auto *layer : shared_) {
+        const auto &vars = isConst ? layer->constVars : layer->mutableVars;
+        auto it = vars.find(type);
+        if (it == vars.end())
+            continue;
+        if (pick < it->second.size())
+            return it->second[pick];
+        pick -= it->second.size();
+    }
+    return own.at(type).keys.at(pick);
 }
 
 PropKey BuiltinContext::pickRandomVar(ScopeID scopeID, bool isConst) {
@@ -205,14 +359,22 @@ PropKey BuiltinContext::pickRandomVar(ScopeID scopeID,
 
 /*------------------ pickRandomMethod ------------------*/
 PropKey BuiltinContext::pickRandomFunc(ScopeID scopeID) {
-    if (scopeID >= funcList_.size())
+    if (static_cast<size_t>(scopeID) >= scopes_.size())
         return PropKey::emptyKey();
-    const auto &lst = funcList_.at(scopeID);
-    if (lst.empty())
+    const auto &own = scopes_[scopeID].funcs.keys;
+    size_t cnt = own.size();
+    for (const auto *layer : shared_)
+        cnt += layer->funcs.size();
+    if (cnt == 0)
         return PropKey::emptyKey();
 
-    size_t pick = funcDist_.at(scopeID)(rng);
-    return lst.at(pick);
+    size_t pick = pickBelow(cnt);
+    for (const auto *layer : shared_) {
+        if (pick < layer->funcs.size())
+            return layer->funcs[pick];
+        pick -= layer->funcs.size();
+    }
+    return own.at(pick);
 }
 
 PropKey BuiltinContext::pickRandomMethod(TypeID tid) {
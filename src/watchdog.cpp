@@ -0,0 +1,92 @@
+#include "watchdog.hpp"
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <ctime>
+#include <pthread.h>
+#include <thread>
+
+using namespace FuzzingAST;
+
+// polling period of the watchdog thread, bounds how late a strike can be
+static constexpr long TICK_MS = 5;
+// least time between the soft and the hard strike. A short timeout would
+// otherwise give an interrupted line hardly any time to unwind before the
+// interpreter is dropped
+static constexpr int64_t MIN_GRACE_MS = 600;
+
+// Each arm starts a new epoch. A strike records the epoch it was meant for,
+// so one that lands after the execution ended can't hit the next one.
+static std::atomic<uint64_t> epoch{0};
+static std::atomic<int64_t> deadline{0}; // monotonic ms, 0 while disarmed
+static std::atomic<uint32_t> period{0};
+static std::atomic<uint64_t> softEpoch{~uint64_t(0)};
+static std::atomic<uint64_t> hardEpoch{~uint64_t(0)};
+static std::atomic<Watchdog::Strike> softStrike{nullptr};
+static pthread_t owner;
+static bool started = false;
+
+__attribute__((no_sanitize("coverage"))) static int64_t nowMs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+// not instrumented, its edges would land in the trace of whatever the main
+// thread is executing
+__attribute__((no_sanitize("coverage"))) static void watch() {
+    const timespec tick{0, TICK_MS * 1000000};
+    while (true) {
+        nanosleep(&tick, nullptr);
+        const auto e = epoch.load(std::memory_order_acquire);
+        const auto d = deadline.load(std::memory_order_acquire);
+        // re-armed in between, d may belong to the next epoch
+        if (d == 0 || epoch.load(std::memory_order_acquire) != e)
+            continue;
+        const auto now = nowMs();
+        if (now < d)
+            continue;
+        if (softEpoch.load(std::memory_order_relaxed) != e) {
+            softEpoch.store(e, std::memory_order_release);
+            if (auto soft = softStrike.load(std::memory_order_acquire))
+                soft();
+        } else if (now >= d + std::max<int64_t>(
+                                  period.load(std::memory_order_relaxed),
+                                  MIN_GRACE_MS) &&
+                   hardEpoch.load(std::memory_order_relaxed) != e) {
+            hardEpoch.store(e, std::memory_order_release);
+            pthread_kill(owner, SIGALRM);
+        }
+    }
+}
+
+void Watchdog::start(Strike soft) {
+    softStrike.store(soft, std::memory_order_release);
+    if (started)
+        return;
+    started = true;
+    owner = pthread_self();
+    std::thread(watch).detach();
+}
+
+void Watchdog::arm(uint32_t timeoutMs) {
+    period.store(timeoutMs, std::memory_order_relaxed);
+    epoch.fetch_add(1, std::memory_order_acq_rel);
+    deadline.store(nowMs() + timeoutMs, std::memory_order_release);
+}
+
+void Watchdog::disarm() { deadline.store(0, std::memory_order_release); }
+
+bool Watchdog::armed() {
+    return deadline.load(std::memory_order_acquire) != 0;
+}
+
+bool Watchdog::softStruck() {
+    return softEpoch.load(std::memory_order_acquire) ==
+           epoch.load(std::memory_order_acquire);
+}
+
+bool Watchdog::hardStruck() {
+    return hardEpoch.load(std::memory_order_acquire) ==
+           epoch.load(std::memory_order_acquire);
+}
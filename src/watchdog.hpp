@@ -0,0 +1,29 @@
+#ifndef WATCHDOG_HPP
+#define WATCHDOG_HPP
+
+#include <cstdint>
+
+namespace FuzzingAST::Watchdog {
+// Execution timeouts without a timer syscall per execution. arm/disarm only
+// publish a deadline, a thread started once polls it. When it passes, the
+// soft strike asks the interpreter to stop at its next safe point. If the
+// execution is still running one more timeout (600ms at least) later, the
+// hard strike sends SIGALRM to the thread that called start, the target's
+// handler then drops the interpreter as the last resort.
+using Strike = void (*)();
+
+// spawn the thread on the first call, later calls only replace soft, which
+// runs on the watchdog thread and may be nullptr if the target polls
+void start(Strike soft);
+// bracket one execution on the thread that called start
+void arm(uint32_t timeoutMs);
+void disarm();
+// an execution is in flight, safe in a signal handler
+bool armed();
+// the execution in flight, or the last one, got the soft/hard strike. Safe in
+// a signal handler
+bool softStruck();
+bool hardStruck();
+} // namespace FuzzingAST::Watchdog
+
+#endif // WATCHDOG_HPP
@@ -0,0 +1,351 @@
+#include <Python.h> // Python.h should be first to include
+#include "codegen.hpp"
+#include "dumper.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+
+using namespace FuzzingAST;
+
+// A line shape is its kind, operators and the form of every operand: a dotted
+// name with N components or a constant. The first line of a shape is dumped
+// with placeholder operands and compiled once, later lines copy the template
+// with their own co_names / co_consts through code.replace().
+
+static constexpr size_t MAX_LINE_TEMPLATES = 1024;
+static constexpr size_t MAX_LITERALS = 4096;
+
+static constexpr std::array PY_KEYWORDS{
+    "False", "None",   "True",    "and",      "as",       "assert", "async",
+    "await", "break",  "class",   "continue", "def",      "del",    "elif",
+    "else",  "except", "finally", "for",      "from",     "global", "if",
+    "import", "in",    "is",      "lambda",   "nonlocal", "not",    "or",
+    "pass",  "raise",  "return",  "try",      "while",    "with",   "yield"};
+
+struct LineTemplate {
+    PyObjectPtr code; // nullptr when the shape can't be templated
+    PyObjectPtr names;
+    PyObjectPtr consts;
+    std::vector<Py_ssize_t> nameIdx;  // co_names slot per name placeholder
+    std::vector<Py_ssize_t> constIdx; // co_consts slot per const placeholder
+};
+
+// operand of a line, a name path or a literal, anything else is verbatim
+struct Operand {
+    std::vector<std::string_view> parts;
+    PyObject *value = nullptr; // borrowed from the literal cache
+};
+
+static std::unordered_map<std::string, LineTemplate> lineTemplates;
+// literal text -> value, nullptr if it isn't an immutable constant
+static std::unordered_map<std::string, PyObjectPtr> literals;
+
+static bool isIdentifier(std::string_view s) {
+    if (s.empty() || std::isdigit(static_cast<unsigned char>(s[0])))
+        return false;
+    for (char c : s)
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_')
+            return false;
+    return std::find(PY_KEYWORDS.begin(), PY_KEYWORDS.end(), s) ==
+           PY_KEYWORDS.end();
+}
+
+static bool splitNamePath(std::string_view s,
+                          std::vector<std::string_view> &parts) {
+    parts.clear();
+    size_t start = 0;
+    while (true) {
+        const auto dot = s.find('.', start);
+        const auto part = s.substr(start, dot - start);
+        if (!isIdentifier(part))
+            return false;
+        parts.push_back(part);
+        if (dot == std::string_view::npos)
+            return true;
+        start = dot + 1;
+    }
+}
+
+static bool isImmutableConst(PyObject *obj) {
+    return obj == Py_None || obj == Py_Ellipsis || PyBool_Check(obj) ||
+           PyLong_CheckExact(obj) || PyFloat_CheckExact(obj) ||
+           PyComplex_CheckExact(obj) || PyUnicode_CheckExact(obj) ||
+           PyBytes_CheckExact(obj);
+}
+
+// a single number or string/bytes token, or None/True/False. Expressions
+// are left to compileSource: folded into one constant they could bind
+// differently in the template, and evaluating them isn't bounded
+static bool isAtomicLiteral(std::string_view s, bool allowSign) {
+    if (s == "None" || s == "True" || s == "False")
+        return true;
+    const bool negated = allowSign && s.starts_with('-');
+    if (negated)
+        s.remove_prefix(1);
+    if (s.empty())
+        return false;
+    if (std::isdigit(static_cast<unsigned char>(s[0])) ||
+        (s[0] == '.' && s.size() > 1)) {
+        // a sign is only part of the token right after a decimal exponent
+        for (size_t i = 0; i < s.size(); ++i) {
+            const auto c = static_cast<unsigned char>(s[i]);
+            if (std::isalnum(c) || c == '_' || c == '.')
+                continue;
+            const bool hex = s.starts_with("0x") || s.starts_with("0X");
+            if ((c != '+' && c != '-') || hex ||
+                (s[i - 1] != 'e' && s[i - 1] != 'E'))
+                return false;
+        }
+        return true;
+    }
+    // only numbers take a sign. No f-strings, their fields are code
+    if (negated)
+        return false;
+    size_t i = 0;
+    while (i < s.size() && std::strchr("rRbBuU", s[i]))
+        ++i;
+    if (i > 2 || i == s.size() || (s[i] != '\'' && s[i] != '"'))
+        return false;
+    const bool triple =
+        s.size() - i >= 3 && s[i + 1] == s[i] && s[i + 2] == s[i];
+    const auto quote = s.substr(i, triple ? 3 : 1);
+    for (i += quote.size(); i < s.size(); ++i) {
+        if (s[i] == '\\')
+            ++i;
+        else if (s.substr(i).starts_with(quote))
+            return i + quote.size() == s.size();
+    }
+    return false;
+}
+
+static PyObject *literalValue(const Symbol &sym, bool allowSign) {
+    static std::string text;
+    text.clear();
+    sym.appendTo(text);
+    if (!isAtomicLiteral(text, allowSign))
+        return nullptr;
+    auto it = literals.find(text);
+    if (it != literals.end())
+        return it->second.get();
+    PyObjectPtr value;
+    PyObjectPtr code(Py_CompileString(text.c_str(), "<ast>", Py_eval_input));
+    if (code) {
+        PyObjectPtr globals(PyDict_New());
+        value.reset(PyEval_EvalCode(code.get(), globals.get(), globals.get()));
+        if (value && !isImmutableConst(value.get()))
+            value.reset();
+    }
+    PyErr_Clear();
+    return literals.emplace(text, std::move(value)).first->second.get();
+}
+
+static size_t operatorField(ASTNodeKind kind) {
+    switch (kind) {
+    case ASTNodeKind::BinaryOp:
+        return 2;
+    case ASTNodeKind::UnaryOp:
+        return 1;
+    default:
+        return static_cast<size_t>(-1);
+    }
+}
+
+// -2 ** y is -(2 ** y), a folded -2 would be raised instead
+static bool allowSign(const ASTNode &node, size_t field) {
+    if (node.kind != ASTNodeKind::BinaryOp || field != 1 ||
+        node.fields.size() < 3)
+        return true;
+    const auto *op = std::get_if<Symbol>(&node.fields[2].val);
+    return !op || *op != "**";
+}
+
+static Py_ssize_t findInTuple(PyObject *tuple, PyObject *item) {
+    for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(tuple); ++i) {
+        PyObject *cur = PyTuple_GET_ITEM(tuple, i);
+        if (PyUnicode_Check(cur) && PyUnicode_Compare(cur, item) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static void buildTemplate(LineTemplate &tmpl, const ASTNode &node,
+                          const std::vector<Operand> &operands,
+                          const AST &ast, const BuiltinContext &ctx) {
+    ASTNode placeholder{node.kind, {}, node.scope};
+    std::vector<std::string> names, consts;
+    for (size_t i = 0; i < node.fields.size(); ++i) {
+        const auto &op = operands[i];
+        if (op.value) {
+            consts.push_back("\x01gf" + std::to_string(consts.size()));
+            placeholder.fields.push_back(
+                {"'\\x01gf" + std::to_string(consts.size() - 1) + "'"});
+        } else if (!op.parts.empty()) {
+            std::string path;
+            for (size_t j = 0; j < op.parts.size(); ++j) {
+                names.push_back("_gf" + std::to_string(names.size()));
+                path += (j ? "." : "") + names.back();
+            }
+            placeholder.fields.push_back({path});
+        } else {
+            placeholder.fields.push_back(node.fields[i]);
+        }
+    }
+    static CodeBuffer script;
+    script.clear();
+    nodeToPython(script, placeholder, ast, ctx, 0);
+    PyObjectPtr code(
+        Py_CompileString(script.str().c_str(), "<ast>", Py_file_input));
+    if (!code) {
+        PyErr_Clear();
+        return;
+    }
+    PyObjectPtr coNames(PyObject_GetAttrString(code.get(), "co_names"));
+    PyObjectPtr coConsts(PyObject_GetAttrString(code.get(), "co_consts"));
+    if (!coNames || !coConsts) {
+        PyErr_Clear();
+        return;
+    }
+    // a placeholder folded away by the compiler makes the shape unusable
+    for (const auto &name : names) {
+        PyObjectPtr str(PyUnicode_FromString(name.c_str()));
+        const auto idx = findInTuple(coNames.get(), str.get());
+        if (idx < 0)
+            return;
+        tmpl.nameIdx.push_back(idx);
+    }
+    for (const auto &cst : consts) {
+        PyObjectPtr str(PyUnicode_FromStringAndSize(cst.data(), cst.size()));
+        const auto idx = findInTuple(coConsts.get(), str.get());
+        if (idx < 0)
+            return;
+        tmpl.constIdx.push_back(idx);
+    }
+    tmpl.code = std::move(code);
+    tmpl.names = std::move(coNames);
+    tmpl.consts = std::move(coConsts);
+}
+
+// copy `tuple`, putting values at the given slots, steals the values
+static PyObjectPtr patchTuple(PyObject *tuple,
+                              const std::vector<Py_ssize_t> &slots,
+                              std::vector<PyObject *> &values) {
+    const auto size = PyTuple_GET_SIZE(tuple);
+    PyObjectPtr out(PyTuple_New(size));
+    for (Py_ssize_t i = 0; i < size; ++i) {
+        PyObject *item = PyTuple_GET_ITEM(tuple, i);
+        Py_INCREF(item);
+        PyTuple_SET_ITEM(out.get(), i, item);
+    }
+    for (size_t i = 0; i < slots.size(); ++i) {
+        PyObject *old = PyTuple_GET_ITEM(out.get(), slots[i]);
+        PyTuple_SET_ITEM(out.get(), slots[i], values[i]);
+        Py_DECREF(old);
+    }
+    values.clear();
+    return out;
+}
+
+static PyObject *instantiate(const LineTemplate &tmpl,
+                             const std::vector<Operand> &operands) {
+    static std::vector<PyObject *> names, consts;
+    for (const auto &op : operands) {
+        if (op.value) {
+            Py_INCREF(op.value);
+            consts.push_back(op.value);
+        }
+        for (const auto part : op.parts) {
+            PyObject *str = PyUnicode_FromStringAndSize(part.data(),
+                                                        part.size());
+            PyUnicode_InternInPlace(&str);
+            names.push_back(str);
+        }
+    }
+    PyObjectPtr kwargs(PyDict_New());
+    PyDict_SetItemString(kwargs.get(), "co_names",
+                         patchTuple(tmpl.names.get(), tmpl.nameIdx, names)
+                             .get());
+    PyDict_SetItemString(kwargs.get(), "co_consts",
+                         patchTuple(tmpl.consts.get(), tmpl.constIdx, consts)
+                             .get());
+    PyObjectPtr replace(PyObject_GetAttrString(tmpl.code.get(), "replace"));
+    PyObjectPtr args(PyTuple_New(0));
+    return PyObject_Call(replace.get(), args.get(), kwargs.get());
+}
+
+static PyObject *compileSource(const ASTNode &node, const AST &ast,
+                               const BuiltinContext &ctx) {
+    static CodeBuffer script;
+    script.clear();
+    nodeToPython(script, node, ast, ctx, 0);
+    return Py_CompileString(script.c_str(), "<ast>", Py_file_input);
+}
+
+PyObject *FuzzingAST::compileLine(const ASTNode &node, const AST &ast,
+                                  const BuiltinContext &ctx) {
+    if (node.kind < EXEC_NODE_START || node.kind > EXEC_NODE_END)
+        return compileSource(node, ast, ctx);
+    if (literals.size() >= MAX_LITERALS)
+        literals.clear();
+
+    // reused across calls, steady state does no heap allocation here
+    static std::vector<Operand> operands;
+    static CodeBuffer shape;
+    operands.resize(node.fields.size());
+    shape.clear();
+    shape << static_cast<int>(node.kind);
+    for (size_t i = 0; i < node.fields.size(); ++i) {
+        auto &op = operands[i];
+        op.value = nullptr;
+        const auto *sym = std::get_if<Symbol>(&node.fields[i].val);
+        if (!sym || sym->empty() || i == operatorField(node.kind)) {
+            // part of the shape, kept as is in the template
+            op.parts.clear();
+            shape << 'v' << node.fields[i].val.index();
+            std::visit(
+                [&](const auto &v) {
+                    if constexpr (std::is_same_v<decltype(v), const bool &>)
+                        shape << (v ? '1' : '0');
+                    else
+                        shape << v;
+                },
+                node.fields[i].val);
+            shape << '\0';
+        } else if (splitNamePath(sym->name(), op.parts)) {
+            if (sym->dotted())
+                op.parts.push_back(symbolName(sym->attr));
+            shape << 'n' << op.parts.size();
+        } else if ((op.value = literalValue(*sym, allowSign(node, i)))) {
+            op.parts.clear();
+            shape << 'c';
+        } else {
+            return compileSource(node, ast, ctx);
+        }
+    }
+
+    auto it = lineTemplates.find(shape.str());
+    if (it == lineTemplates.end()) {
+        if (lineTemplates.size() >= MAX_LINE_TEMPLATES)
+            lineTemplates.clear();
+        it = lineTemplates.try_emplace(shape.str()).first;
+        buildTemplate(it->second, node, operands, ast, ctx);
+    }
+    if (!it->second.code)
+        return compileSource(node, ast, ctx);
+    return instantiate(it->second, operands);
+}
+
+void FuzzingAST::releaseLineTemplates() {
+    // objects don't outlive the interpreter, can't DECREF after a timeout
+    for (auto &[_, tmpl] : lineTemplates) {
+        (void)tmpl.code.release();
+        (void)tmpl.names.release();
+        (void)tmpl.consts.release();
+    }
+    lineTemplates.clear();
+    for (auto &[_, value] : literals)
+        (void)value.release();
+    literals.clear();
+}
@@ -0,0 +1,16 @@
+#ifndef CODEGEN_HPP
+#define CODEGEN_HPP
+
+#include "target.hpp"
+
+namespace FuzzingAST {
+// compile an execution line into a code object, lines whose shape was seen
+// before are instantiated from a template without running the parser
+// returns a new reference, nullptr with the Python error set on failure
+PyObject *compileLine(const ASTNode &node, const AST &ast,
+                      const BuiltinContext &ctx);
+// drop templates before the interpreter is finalized
+void releaseLineTemplates();
+} // namespace FuzzingAST
+
+#endif // CODEGEN_HPP
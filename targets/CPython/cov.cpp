@@ -1,7 +1,7 @@
 #include "ast.hpp"
+#include "binser.hpp"
 #include "driver.hpp"
 #include "dumper.hpp"
-#include "serialization.hpp"
 #include <Python.h>
 #include <chrono>
 #include <cstdlib>
@@ -33,7 +33,7 @@ PANIC(std::format_string<Args...> fmt, Args &&...args) {
 }
 
 static std::string readFile(const fs::path &path) {
-    std::ifstream in(path);
+    std::ifstream in(path, std::ios::binary);
     if (!in)
         throw std::runtime_error("Cannot open file: " + path.string());
     return std::string((std::istreambuf_iterator<char>(in)), {});
@@ -67,9 +67,8 @@ static void collect() {
 
         try {
             std::string content = readFile(filePath);
-            nlohmann::json jsonData = nlohmann::json::parse(content);
-            AST ast = jsonData.get<AST>();
-            std::ostringstream astStream;
+            AST ast = BinSer::parseAST(content);
+            CodeBuffer astStream;
             scopeToPython(astStream, 0, ast, ctx, 0);
             // std::cout << "[cov] Running on: " << filename << "\n";
 
@@ -2,31 +2,32 @@
 
 using namespace FuzzingAST;
 
-void valueToPython(std::ostringstream &out, const ASTNodeValue &val,
+void valueToPython(CodeBuffer &out, const ASTNodeValue &val,
                    const AST &ast, const BuiltinContext &ctx, int indentLevel) {
-    if (std::holds_alternative<std::string>(val.val)) {
-        out << std::get<std::string>(val.val);
+    if (std::holds_alternative<Symbol>(val.val)) {
+        out << std::get<Symbol>(val.val);
     } else if (std::holds_alternative<int64_t>(val.val)) {
         out << std::get<int64_t>(val.val);
     } else if (std::holds_alternative<bool>(val.val)) {
         out << (std::get<bool>(val.val) ? "True" : "False");
     } else if (std::holds_alternative<double>(val.val)) {
         out << std::get<double>(val.val);
+    } else if (std::holds_alternative<Literal>(val.val)) {
+        out << std::get<Literal>(val.val);
     } else {
         out << "None";
     }
 }
 
-void FuzzingAST::nodeToPython(std::ostringstream &out, const ASTNode &node,
+void FuzzingAST::nodeToPython(CodeBuffer &out, const ASTNode &node,
                               const AST &ast, const BuiltinContext &ctx,
                               int indentLevel) {
-    const std::string ind(indentLevel * 4, ' ');
-    out << ind;
+    out.indent(indentLevel);
 
     switch (node.kind) {
     case ASTNodeKind::DeclareVar: {
         // name [: type] = value
-        const std::string &name = std::get<std::string>(node.fields[0].val);
+        const Symbol &name = std::get<Symbol>(node.fields[0].val);
         out << name;
         // no annotation bc will conflict with global
         // if (node.type != -1)
@@ -48,7 +49,7 @@ void FuzzingAST::nodeToPython(std::ostringstream &out, const ASTNode &node,
         valueToPython(out, node.fields[1], ast, ctx, indentLevel);
         break;
     case ASTNodeKind::Call:
-        if (!std::get<std::string>(node.fields[0].val).empty()) {
+        if (!std::get<Symbol>(node.fields[0].val).empty()) {
             valueToPython(out, node.fields[0], ast, ctx, indentLevel);
             out << " = ";
         }
@@ -66,13 +67,13 @@ void FuzzingAST::nodeToPython(std::ostringstream &out, const ASTNode &node,
         valueToPython(out, node.fields[0], ast, ctx, indentLevel);
         out << " = ";
         valueToPython(out, node.fields[1], ast, ctx, indentLevel);
-        out << ' ' << std::get<std::string>(node.fields[2].val) << ' ';
+        out << ' ' << std::get<Symbol>(node.fields[2].val) << ' ';
         valueToPython(out, node.fields[3], ast, ctx, indentLevel);
         break;
 
     case ASTNodeKind::UnaryOp:
         valueToPython(out, node.fields[0], ast, ctx, indentLevel);
-        out << " = " << std::get<std::string>(node.fields[1].val) << ' ';
+        out << " = " << std::get<Symbol>(node.fields[1].val) << ' ';
         valueToPython(out, node.fields[2], ast, ctx, indentLevel);
         break;
 
@@ -96,7 +97,7 @@ void FuzzingAST::nodeToPython(std::ostringstream &out, const ASTNode &node,
         break;
 
     case ASTNodeKind::Function: {
-        const std::string &name = std::get<std::string>(node.fields[0].val);
+        const Symbol &name = std::get<Symbol>(node.fields[0].val);
 
         // def fields[0](fields[2]...) -> fields[1]
         size_t paramCnt = node.fields.size() > 2 ? node.fields.size() - 2 : 0;
@@ -104,7 +105,7 @@ void FuzzingAST::nodeToPython(std::ostringstream &out, const ASTNode &node,
         for (size_t i = 0; i < paramCnt; i += 2) {
             if (i)
                 out << ", ";
-            std::string argName = std::get<std::string>(node.fields[2 + i].val);
+            const Symbol &argName = std::get<Symbol>(node.fields[2 + i].val);
             TypeID pt = static_cast<TypeID>(
                 std::get<int64_t>(node.fields[2 + i + 1].val));
             out << argName << ": " << getTypeName(pt, ast, ctx);
@@ -117,9 +118,9 @@ void FuzzingAST::nodeToPython(std::ostringstream &out, const ASTNode &node,
         break;
     }
     case ASTNodeKind::Class: {
-        const std::string &name = std::get<std::string>(node.fields[0].val);
+        const Symbol &name = std::get<Symbol>(node.fields[0].val);
 
-        std::vector<std::string> bases;
+        std::vector<Symbol> bases;
         size_t idx = 1; // collect bases
         for (; idx < node.fields.size(); ++idx) {
             if (std::holds_alternative<int64_t>(node.fields[idx].val) &&
@@ -127,7 +128,7 @@ void FuzzingAST::nodeToPython(std::ostringstream &out, const ASTNode &node,
                 ++idx; // skip sentinel
                 break;
             }
-            bases.push_back(std::get<std::string>(node.fields[idx].val));
+            bases.push_back(std::get<Symbol>(node.fields[idx].val));
         }
 
         out << "class " << name;
@@ -151,19 +152,19 @@ void FuzzingAST::nodeToPython(std::ostringstream &out, const ASTNode &node,
             bodyEmpty = false;
         }
         if (bodyEmpty)
-            out << std::string((indentLevel + 1) * 4, ' ') << "pass";
+            out.indent(indentLevel + 1) << "pass";
         break;
     }
     case ASTNodeKind::GlobalRef: {
         // every field is a string, join with space
-        out << "global " << std::get<std::string>(node.fields[0].val);
+        out << "global " << std::get<Symbol>(node.fields[0].val);
         for (size_t i = 1; i < node.fields.size(); ++i) {
-            out << ", " << std::get<std::string>(node.fields[i].val);
+            out << ", " << std::get<Symbol>(node.fields[i].val);
         }
         break;
     }
     case ASTNodeKind::Import: {
-        out << "exec('from " << std::get<std::string>(node.fields[0].val)
+        out << "exec('from " << std::get<Symbol>(node.fields[0].val)
             << " import *', globals())";
         break;
     }
@@ -175,12 +176,12 @@ void FuzzingAST::nodeToPython(std::ostringstream &out, const ASTNode &node,
     out << '\n';
 }
 
-void FuzzingAST::scopeToPython(std::ostringstream &out, ScopeID sid,
+void FuzzingAST::scopeToPython(CodeBuffer &out, ScopeID sid,
                                const AST &ast, const BuiltinContext &ctx,
                                int indentLevel) {
     if (sid == -1)
         return;
-    out << std::string(indentLevel * 4, ' ') << "# scope " << sid << '\n';
+    out.indent(indentLevel) << "# scope " << sid << '\n';
     const ASTScope &scope = ast.scopes[sid];
     bool empty = true;
 
@@ -209,5 +210,5 @@ void FuzzingAST::scopeToPython(std::ostringstream &out, ScopeID sid,
     }
 
     if (empty)
-        out << std::string(indentLevel * 4, ' ') << "pass\n";
+        out.indent(indentLevel) << "pass\n";
 }
\ No newline at end of file
@@ -2,12 +2,12 @@
 #define DUMPER_HPP
 
 #include "ast.hpp"
-#include <sstream>
+#include "codebuf.hpp"
 
 namespace FuzzingAST {
-void nodeToPython(std::ostringstream &out, const ASTNode &node, const AST &ast,
+void nodeToPython(CodeBuffer &out, const ASTNode &node, const AST &ast,
                   const BuiltinContext &ctx, int indentLevel);
-void scopeToPython(std::ostringstream &out, ScopeID sid, const AST &ast,
+void scopeToPython(CodeBuffer &out, ScopeID sid, const AST &ast,
                    const BuiltinContext &ctx, int indentLevel);
 } // namespace FuzzingAST
 
@@ -1,9 +1,18 @@
 #include <Python.h> // Python.h should be first to include
+#include <marshal.h>
 #include "target.hpp"
 #include "ast.hpp"
+#include "binser.hpp"
+#include "codegen.hpp"
+#include "coverage.hpp"
+#include "crash.hpp"
 #include "driver.hpp"
 #include "dumper.hpp"
+#include "feedback.hpp"
+#include "latency.hpp"
+#include "learned.hpp"
 #include "log.hpp"
+#include "watchdog.hpp"
 #include <atomic>
 #include <chrono>
 #include <cstdlib>
@@ -11,12 +20,14 @@
 #include <fcntl.h>
 #include <fstream>
 #include <iostream>
-#include <regex>
+#include <list>
+#include <poll.h>
 #include <serialization.hpp>
 #include <setjmp.h>
 #include <signal.h>
 #include <sstream>
 #include <sys/shm.h>
+#include <sys/socket.h>
 #include <sys/wait.h>
 #include <thread>
 #include <unistd.h>
@@ -26,27 +37,125 @@ using namespace FuzzingAST;
 
 extern uint32_t newEdgeCnt;
 extern uint32_t errCnt;
+extern uint64_t codeCacheHits;
+extern uint64_t codeCacheMisses;
 static PyObject *driverPyCodeObj;
 static sigjmp_buf timeoutJmp;
 static int nullFd = open("/dev/null", O_WRONLY);
 static int oldStdout = dup(STDOUT_FILENO);
 static int oldStderr = dup(STDERR_FILENO);
 
+// least recently used code objects of lines. Looked up by node hash, a hit
+// is compared with the stored node so a collision can't hand out the code of
+// another line
+class CodeLRU {
+  public:
+    explicit CodeLRU(size_t capacity) : capacity_(capacity) {}
+
+    // borrowed reference, nullptr on a miss
+    PyObject *get(const ASTNode &node) {
+        auto it = index_.find(hashNode(node));
+        if (it == index_.end() || it->second->node != node)
+            return nullptr;
+        order_.splice(order_.begin(), order_, it->second);
+        return it->second->code.get();
+    }
+
+    PyObject *put(const ASTNode &node, PyObjectPtr code) {
+        const size_t key = hashNode(node);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            it->second->node = node;
+            it->second->code = std::move(code);
+            order_.splice(order_.begin(), order_, it->second);
+            return order_.front().code.get();
+        }
+        if (index_.size() >= capacity_) {
+            index_.erase(order_.back().key);
+            order_.pop_back();
+        }
+        order_.push_front({key, node, std::move(code)});
+        index_.emplace(key, order_.begin());
+        return order_.front().code.get();
+    }
+
+    void release() {
+        // objects don't outlive the interpreter, can't DECREF after a timeout
+        for (auto &entry : order_)
+            (void)entry.code.release();
+        order_.clear();
+        index_.clear();
+    }
+
+  private:
+    struct Entry {
+        size_t key;
+        ASTNode node;
+        PyObjectPtr code;
+    };
+    size_t capacity_;
+    std::list<Entry> order_;
+    std::unordered_map<size_t, std::list<Entry>::iterator> index_;
+};
+
+// compiled code kept across streams; scope-0 declaration prefixes keyed by
+// declarationNodes, a hit is compared with the stored nodes, and successful
+// lines
+struct DeclCode {
+    std::vector<ASTNode> nodes;
+    PyObjectPtr code;
+};
+static constexpr size_t MAX_DECL_CODE_CACHE = 64;
+static constexpr size_t MAX_LINE_CODE_CACHE = 1 << 14;
+static std::unordered_map<size_t, DeclCode> declCodeCache;
+static CodeLRU lineCodeCache(MAX_LINE_CODE_CACHE);
+
+#ifdef FORK_SERVER
+struct ForkResult;
+
+// The lines of a stream run in one long-lived child forked from the context
+// once its declarations ran, the parent keeps that state and never runs a
+// line. A line that hangs or crashes costs only the child, the next one is
+// forked from the same state and replays the lines checkpointed so far.
+class FuzzingAST::ForkServer {
+  public:
+    explicit ForkServer(PyObject *dict) : dict_(dict) {}
+    ~ForkServer() { stop(); }
+
+    // 0 or -1 as runLine, -3 if the child hung or died and is gone
+    int run(PyObject *code, const ASTNode &node, uint32_t timeoutMs,
+            ForkResult &res);
+    // a fresh child running codes, they become the checkpointed lines
+    int replay(const std::vector<PyObject *> &codes, ForkResult &res);
+    // "name\0type\0" pairs of the child's globals, false without a child
+    bool types(std::string &out);
+    void checkpoint();
+    bool restore();
+    void stop();
+
+  private:
+    int start(ForkResult &res);
+    int request(uint32_t kind, std::string_view payload, uint32_t timeoutMs,
+                ForkResult &res);
+    void lost();
+
+    PyObject *dict_;
+    pid_t pid_ = -1;
+    int sock_ = -1;
+    // marshalled code of the lines that succeeded, up to the last checkpoint
+    // and since it
+    std::vector<std::string> committed_;
+    std::vector<std::string> pending_;
+};
+#endif
+
 extern "C" void __sanitizer_cov_trace_pc_guard_init(uint32_t *start,
                                                     uint32_t *stop) {
-    if (start == stop || *start)
-        return;
-    static uint32_t N = 0;
-    for (uint32_t *x = start; x < stop; ++x) {
-        *x = ++N;
-    }
+    registerGuards(start, stop);
 }
 
 extern "C" void __sanitizer_cov_trace_pc_guard(uint32_t *guard) {
-    if (!*guard)
-        return;
-    newEdgeCnt++;
-    *guard = 0;
+    traceEdge(*guard);
 }
 
 class NullStdIORedirect {
@@ -66,26 +175,164 @@ class NullStdIORedirect {
     }
 };
 
+// Timeouts come from the watchdog. Its soft strike schedules raiseTimeout,
+// which raises TimeoutError at the next eval breaker check and keeps doing so
+// until the code gives up, an except clause can't swallow it for good. Code
+// stuck in C never gets there, the hard strike's SIGALRM then jumps out and
+// the interpreter is restarted.
+static int raiseTimeout(void *) {
+    if (!Watchdog::armed() || !Watchdog::softStruck())
+        return 0; // the execution ended in between
+    Py_AddPendingCall(raiseTimeout, nullptr);
+    PyErr_SetString(PyExc_TimeoutError, "execution timed out");
+    return -1;
+}
+
+static void softStrike() { Py_AddPendingCall(raiseTimeout, nullptr); }
+
+// set while runBatch updates its own state between two lines, a hard strike
+// arriving then is taken once the state is consistent again
+static volatile sig_atomic_t deferAlarm = 0;
+static volatile sig_atomic_t alarmPending = 0;
+
 static void alarmHandler(int signum) {
-    if (signum == SIGALRM) {
-        ERROR("Execution timed out.");
-        siglongjmp(timeoutJmp, 1);
+    // a strike for an execution that already ended
+    if (signum != SIGALRM || !Watchdog::armed() || !Watchdog::hardStruck())
+        return;
+    if (deferAlarm) {
+        alarmPending = 1;
+        return;
     }
+    ERROR("Execution timed out.");
+    siglongjmp(timeoutJmp, 1);
 }
 
-static void set_timeout_ms(int timeout_ms) {
-    struct itimerval timer{};
-    timer.it_value.tv_sec = timeout_ms / 1000;
-    timer.it_value.tv_usec = (timeout_ms % 1000) * 1000;
+static int dictWatcherID = -1;
+static std::unordered_map<PyObject *, PythonExecutionContext *> watchedDicts;
 
-    timer.it_interval.tv_sec = 0;
-    timer.it_interval.tv_usec = 0; // one-shot
-    setitimer(ITIMER_REAL, &timer, nullptr);
+static int globalsWatcher(PyDict_WatchEvent event, PyObject *dict,
+                          PyObject *key, PyObject * /*newValue*/) {
+    auto it = watchedDicts.find(dict);
+    if (it != watchedDicts.end())
+        it->second->recordChange(event, key);
+    return 0;
+}
+
+#ifdef FORK_SERVER
+ForkServer &PythonExecutionContext::forkServer() {
+    if (!fork_)
+        fork_ = std::make_unique<ForkServer>(dict_.get());
+    return *fork_;
 }
+#endif
+
+// out of line, ForkServer is incomplete in the header
+PythonExecutionContext::PythonExecutionContext(PyObjectPtr dict)
+    : dict_(std::move(dict)) {}
 
-static void clear_timeout() {
-    struct itimerval zero = {};
-    setitimer(ITIMER_REAL, &zero, nullptr);
+PythonExecutionContext::~PythonExecutionContext() {
+    if (watching_) {
+        watchedDicts.erase(dict_.get());
+        PyDict_Unwatch(dictWatcherID, dict_.get());
+        PyErr_Clear();
+    }
+}
+
+void PythonExecutionContext::releasePtr() {
+#ifdef FORK_SERVER
+    fork_.reset();
+#endif
+    // the interpreter is gone, so are the logged objects
+    for (auto &[key, value] : undoLog_) {
+        (void)key.release();
+        (void)value.release();
+    }
+    undoLog_.clear();
+    loggedKeys_.clear();
+    if (watching_)
+        watchedDicts.erase(dict_.get());
+    watching_ = false;
+    logValid_ = false;
+    (void)dict_.release();
+}
+
+void PythonExecutionContext::clearUndoLog() {
+    undoLog_.clear();
+    loggedKeys_.clear();
+}
+
+void PythonExecutionContext::checkpoint() {
+#ifdef FORK_SERVER
+    // the dict stays as the declarations left it, the lines live in the child
+    if (fork_)
+        fork_->checkpoint();
+    return;
+#endif
+    if (!dict_ || dictWatcherID < 0)
+        return;
+    if (!watching_) {
+        if (PyDict_Watch(dictWatcherID, dict_.get()) != 0) {
+            PyErr_Clear();
+            return;
+        }
+        watchedDicts[dict_.get()] = this;
+        watching_ = true;
+    }
+    clearUndoLog();
+    logValid_ = true;
+}
+
+void PythonExecutionContext::recordChange(PyDict_WatchEvent event,
+                                          PyObject *key) {
+    if (restoring_ || !logValid_)
+        return;
+    switch (event) {
+    case PyDict_EVENT_ADDED:
+    case PyDict_EVENT_MODIFIED:
+    case PyDict_EVENT_DELETED: {
+        // only the value at checkpoint time matters
+        if (!loggedKeys_.insert(key).second)
+            return;
+        PyObject *old = PyDict_GetItemWithError(dict_.get(), key);
+        if (!old && PyErr_Occurred()) {
+            PyErr_Clear();
+            logValid_ = false;
+            return;
+        }
+        Py_INCREF(key);
+        Py_XINCREF(old);
+        undoLog_.emplace_back(PyObjectPtr(key), PyObjectPtr(old));
+        break;
+    }
+    case PyDict_EVENT_CLEARED:
+    case PyDict_EVENT_CLONED:
+        // too coarse to log, the caller replays the history instead
+        logValid_ = false;
+        clearUndoLog();
+        break;
+    default:
+        break;
+    }
+}
+
+bool PythonExecutionContext::restore() {
+#ifdef FORK_SERVER
+    return dict_ && forkServer().restore();
+#endif
+    if (!dict_ || !logValid_)
+        return false;
+    restoring_ = true;
+    PyObject *exc = PyErr_GetRaisedException();
+    for (auto it = undoLog_.rbegin(); it != undoLog_.rend(); ++it) {
+        if (it->second)
+            PyDict_SetItem(dict_.get(), it->first.get(), it->second.get());
+        else if (PyDict_DelItem(dict_.get(), it->first.get()) != 0)
+            PyErr_Clear();
+    }
+    PyErr_SetRaisedException(exc);
+    restoring_ = false;
+    clearUndoLog();
+    return true;
 }
 
 static void installSignalHandler() {
@@ -128,6 +375,7 @@ int FuzzingAST::initialize(int *argc, char ***argv) {
     driverPyStream.close();
 
     installSignalHandler();
+    Watchdog::start(softStrike);
 
     PyConfig config;
     PyStatus status;
@@ -157,10 +405,28 @@ int FuzzingAST::initialize(int *argc, char ***argv) {
 
     takePipe("stderr");
     takePipe("stdout");
+    // watchers are per interpreter, register again after every restart
+    dictWatcherID = PyDict_AddWatcher(globalsWatcher);
+    if (dictWatcherID < 0) {
+        PyErr_Clear();
+        ERROR("Failed to add dict watcher, falling back to replay");
+    }
     return 0;
 }
 
-int FuzzingAST::finalize() { return Py_FinalizeEx(); }
+static void releaseCodeCache(std::unordered_map<size_t, DeclCode> &cache) {
+    // objects don't outlive the interpreter, can't DECREF after a timeout
+    for (auto &[_, decl] : cache)
+        (void)decl.code.release();
+    cache.clear();
+}
+
+int FuzzingAST::finalize() {
+    releaseCodeCache(declCodeCache);
+    lineCodeCache.release();
+    releaseLineTemplates();
+    return Py_FinalizeEx();
+}
 
 void FuzzingAST::dummyAST(ASTData &data, const BuiltinContext &ctx) {
     // Seed with every primitive type so the variable pool is rich from the
@@ -199,18 +465,20 @@ void FuzzingAST::dummyAST(ASTData &data, const BuiltinContext &ctx) {
     data.ast.declarations[10] =
         ASTNode{ASTNodeKind::DeclareVar, {{"dict_a"}, {"{}"}}};
 
-    data.ast.classProps[-1].resize(NUM_SEED);
-    data.ast.classProps[-1][0] = PropInfo{ctx.strID,      0, "str_a",   false};
-    data.ast.classProps[-1][1] = PropInfo{ctx.strID,      0, "str_b",   false};
-    data.ast.classProps[-1][2] = PropInfo{bytesType,      0, "byte_a",  false};
-    data.ast.classProps[-1][3] = PropInfo{ctx.intID,      0, "int_a",   false};
-    data.ast.classProps[-1][4] = PropInfo{ctx.intID,      0, "int_b",   false};
-    data.ast.classProps[-1][5] = PropInfo{ctx.floatID,    0, "float_a", false};
-    data.ast.classProps[-1][6] = PropInfo{ctx.boolID,     0, "bool_a",  false};
-    data.ast.classProps[-1][7] = PropInfo{ctx.boolID,     0, "bool_b",  false};
-    data.ast.classProps[-1][8] = PropInfo{listType,       0, "list_a",  false};
-    data.ast.classProps[-1][9] = PropInfo{bytearrayType,  0, "ba_a",    false};
-    data.ast.classProps[-1][10] = PropInfo{dictType,      0, "dict_a",  false};
+    // assigned as a whole, names can't change once the list indexed them
+    data.ast.classProps[-1] = std::vector<PropInfo>{
+        PropInfo{ctx.strID,      0, "str_a",   false},
+        PropInfo{ctx.strID,      0, "str_b",   false},
+        PropInfo{bytesType,      0, "byte_a",  false},
+        PropInfo{ctx.intID,      0, "int_a",   false},
+        PropInfo{ctx.intID,      0, "int_b",   false},
+        PropInfo{ctx.floatID,    0, "float_a", false},
+        PropInfo{ctx.boolID,     0, "bool_a",  false},
+        PropInfo{ctx.boolID,     0, "bool_b",  false},
+        PropInfo{listType,       0, "list_a",  false},
+        PropInfo{bytearrayType,  0, "ba_a",    false},
+        PropInfo{dictType,      0, "dict_a",  false},
+    };
 
     data.ast.variables.resize(NUM_SEED);
     for (int i = 0; i < NUM_SEED; ++i) {
@@ -235,271 +503,484 @@ static std::string getQuoteText(const std::string &str, size_t &pos) {
     return str.substr(start, end - start + 1);
 }
 
-static void errorCallback(AST &ast, BuiltinContext &ctx,
-                          std::optional<ASTNode> node = std::nullopt) {
-    PyObjectPtr exc(PyErr_GetRaisedException());
-    PyObjectPtr errVal(PyObject_Str(exc.get()));
-    std::string errMsg(PyUnicode_AsUTF8(errVal.get()));
-#ifndef DISABLE_DEBUG_OUTPUT
-    // PyErr_Print();
-    ERROR("Failed to run code: {}", errMsg);
-#endif
-    // fix builtin sig dynamically
-    if (PyErr_GivenExceptionMatches(exc.get(), PyExc_TypeError)) {
-        bool handled = false;
-        const static std::string badUnaryOp("bad operand type for unary ");
-        const static std::string noAttr(" has no attribute ");
-        const static std::string badDescriptor("descriptor ");
-        if (errMsg.starts_with(badUnaryOp) && !handled) {
-            // e.g. bad operand type for unary ~: 'str'
-            std::regex regexPattern(
-                R"(bad operand type for unary (\S+): '(\S+)')");
-            std::smatch match;
-            if (std::regex_search(errMsg, match, regexPattern)) {
-                std::string opName = match[1];
-                std::string targetType = match[2];
-
-                auto opIt =
-                    std::find(UNARY_OPS.begin(), UNARY_OPS.end(), opName);
-                if (opIt != UNARY_OPS.end()) {
-                    auto &op = ctx.unaryOps[opIt - UNARY_OPS.begin()];
-
-                    auto typeIt = std::find(ctx.types.begin(), ctx.types.end(),
-                                            targetType);
-                    if (typeIt != ctx.types.end()) {
-                        TypeID typeID = typeIt - ctx.types.begin();
-
-                        auto found = std::find(op.begin(), op.end(), typeID);
-                        if (found != op.end()) {
-                            op.erase(found);
-                            INFO("Removed typeID {} from unary op '{}'", typeID,
-                                 opName);
-                        } else {
-                            // INFO("TypeID {} not found in op '{}', nothing to
-                            // remove",
-                            //      typeID, opName);
-                        }
-                        handled = true;
-                    }
-                }
-            }
+// What a failed line tells about the builtins. Read from the exception and
+// its traceback where CPython exposes it, the message is only matched against
+// the rule tables when that isn't enough.
+struct ErrorFacts {
+    enum Kind : int32_t { Other, TypeError, AttributeError };
+    Kind kind = Other;
+    std::string msg;
+    // AttributeError: the missing name and the type it was looked up on
+    std::string attr, objType;
+    // TypeError raised by the line's own call: the callee, the type it was
+    // looked up on (empty for a free function) and its positional arity
+    std::string callee, ownerType;
+    int32_t minArgs = -1; // -1 if unknown
+    int32_t maxArgs = -1; // -1 if unbounded
+};
+
+static std::string typeNameOf(PyObject *obj) {
+    PyObjectPtr name(PyType_GetName(Py_TYPE(obj)));
+    const char *str = name ? PyUnicode_AsUTF8(name.get()) : nullptr;
+    return str ? str : "";
+}
+
+// innermost traceback frame if it is the generated code itself, i.e. the
+// error came from a call made by the line rather than from deeper down
+static PyObjectPtr lineFrame(PyObject *exc) {
+    PyObjectPtr tb(PyException_GetTraceback(exc));
+    if (!tb)
+        return nullptr;
+    while (true) {
+        PyObjectPtr next(PyObject_GetAttrString(tb.get(), "tb_next"));
+        if (!next || next.get() == Py_None)
+            break;
+        tb = std::move(next);
+    }
+    PyObjectPtr frame(PyObject_GetAttrString(tb.get(), "tb_frame"));
+    if (!frame || !PyFrame_Check(frame.get()))
+        return nullptr;
+    PyObjectPtr code(reinterpret_cast<PyObject *>(
+        PyFrame_GetCode(reinterpret_cast<PyFrameObject *>(frame.get()))));
+    PyObjectPtr file(PyObject_GetAttrString(code.get(), "co_filename"));
+    if (!file || !PyUnicode_Check(file.get()) ||
+        PyUnicode_CompareWithASCIIString(file.get(), "<ast>") != 0)
+        return nullptr;
+    return frame;
+}
+
+// positional arity of a __text_signature__ like "($self, x, y=None, /)".
+// $-parameters are bound already, keyword-only ones follow a bare *
+static bool parseTextSignature(std::string_view sig, ErrorFacts &facts) {
+    if (sig.size() < 2 || sig.front() != '(' || sig.back() != ')')
+        return false;
+    sig = sig.substr(1, sig.size() - 2);
+    int32_t minArgs = 0, maxArgs = 0;
+    bool varArgs = false;
+    size_t depth = 0, begin = 0;
+    char quote = 0;
+    for (size_t i = 0; i <= sig.size() && !varArgs; ++i) {
+        const char c = i < sig.size() ? sig[i] : ',';
+        if (quote) {
+            quote = c == quote ? 0 : quote;
+            continue;
         }
-        if (errMsg.contains(noAttr) && !handled) {
-            // e.g. 'dict' object has no attribute 'find'
-            std::regex regexPattern(R"((\S+) object has no attribute '(\S+)')");
-            std::smatch match;
-            if (std::regex_search(errMsg, match, regexPattern)) {
-                std::string typeName = match[1];
-                std::string attrName = match[2];
-                TypeID tid = resolveType(typeName, ctx, ast, 0);
-                if (tid <= 0) {
-                    // extracted type in errMsg can be inaccurate (like base
-                    // class name)
-                    handled = true;
-                    std::string obj = "";
-                    if (node->kind == ASTNodeKind::Call) {
-                        obj = std::get<std::string>(node->fields[0].val);
-                        obj = obj.substr(0, obj.find('.'));
-                    } else if (node->kind == ASTNodeKind::GetProp) {
-                        obj = std::get<std::string>(node->fields[1].val);
-                        obj = obj.substr(0, obj.find('.'));
-                    } else if (node->kind == ASTNodeKind::SetProp) {
-                        obj = std::get<std::string>(node->fields[0].val);
-                        obj = obj.substr(0, obj.find('.'));
-                    } else
-                        handled = false;
-                } else {
-                    auto &props = tid < ctx.builtinTypesCnt
-                                      ? ctx.builtinsProps[tid]
-                                      : ast.classProps[tid];
-
-                    auto it = std::find_if(props.begin(), props.end(),
-                                           [&attrName](const PropInfo &prop) {
-                                               return prop.name == attrName;
-                                           });
-                    if (it != props.end()) {
-                        // remove the property
-                        props.erase(it);
-                        INFO("Removed property '{}' from typeID {}", attrName,
-                             tid);
-                        handled = true;
-                    }
-                }
-            }
+        if (c == '\'' || c == '"')
+            quote = c;
+        else if (c == '(' || c == '[' || c == '{')
+            ++depth;
+        else if (c == ')' || c == ']' || c == '}')
+            --depth;
+        if (c != ',' || depth)
+            continue;
+        auto param = sig.substr(begin, i - begin);
+        begin = i + 1;
+        while (!param.empty() && param.front() == ' ')
+            param.remove_prefix(1);
+        if (param.empty() || param == "/" || param.front() == '$' ||
+            param.starts_with("**"))
+            continue;
+        if (param.front() == '*') {
+            varArgs = param.size() > 1;
+            break;
         }
-        if (errMsg.starts_with(badDescriptor) && !handled) {
-            // e.g. descriptor '__rand__' requires a 'bool' object but received
-            // a 'str'
-            // TODO
-        }
-        if (errMsg.contains(" argument ") && errMsg.contains(" must be ") &&
-            !handled) {
-            // e.g. replace() argument 1 must be str, not None
-            std::regex regexPattern(
-                R"((\S+)\(\) argument (\d+) must be (\S+), not (\S+))");
-            std::smatch match;
-            if (std::regex_search(errMsg, match, regexPattern)) {
-                std::string funcName = match[1];
-                size_t argNum = std::stoul(match[2]);
-                std::string expType = match[3];
-
-                const auto p = funcName.find('.');
-                if (p != std::string::npos) {
-                    const std::string &typeName = funcName.substr(0, p);
-                    const std::string &methodName = funcName.substr(p + 1);
-                    TypeID tid = resolveType(typeName, ctx, ast, 0);
-                    if (tid > 0) {
-                        auto &methods = tid < ctx.builtinTypesCnt
-                                            ? ctx.builtinsProps[tid]
-                                            : ast.classProps[tid];
-                        auto it =
-                            std::find_if(methods.begin(), methods.end(),
-                                         [&methodName](const PropInfo &prop) {
-                                             return prop.name == methodName;
-                                         });
-                        if (it != methods.end()) {
-                            it->funcSig.paramTypes[argNum - 1] =
-                                resolveType(expType, ctx, ast, 0);
-                            INFO("Updated method '{}' for expected "
-                                 "type '{}'({}) for argument {}",
-                                 methodName, expType, tid, argNum);
-                        }
-                    }
-                } else {
-                    // no designed parent type, we only search in builtins
-                    // caused custom func should already has type.
-                    auto it = std::find_if(ctx.builtinsProps.at(-1).begin(),
-                                           ctx.builtinsProps.at(-1).end(),
-                                           [&funcName](const auto &info) {
-                                               return info.name == funcName;
-                                           });
-                    if (it != ctx.builtinsProps.at(-1).end()) {
-                        const auto tid = resolveType(expType, ctx, ast, 0);
-                        it->funcSig.paramTypes[argNum - 1] = tid;
-                        INFO("Updated function '{}' with expected type "
-                             "'{}'({}) for "
-                             "argument {}",
-                             funcName, expType, tid, argNum);
-                    } else {
-                        WARN("Failed to find function '{}' in builtins",
-                             funcName);
-                    }
-                }
-                handled = true;
-            }
-            // otherwise is not this template error
-        }
-        // Argument-count errors — three CPython error formats:
-        //   (A) "rfind expected at most 3 arguments, got 4"
-        //   (B) "iter() takes from 1 to 2 positional arguments but 0 were given"
-        //   (C) "issubclass() takes exactly 2 arguments (0 given)"
-        if (!handled && node && node->kind == ASTNodeKind::Call) {
-            enum class ArgCountFmt { None, AtMostLeast, TakesFrom, TakesExactly };
-            static const std::regex reAtMostLeast(
-                R"((\S+) expected at (?:most|least) (\d+) arguments, got (\d+))");
-            static const std::regex reTakesFrom(
-                R"(\S+\(\) takes from (\d+) to \d+ positional arguments but \d+ were given)");
-            static const std::regex reTakesExactly(
-                R"(\S+\(\) takes exactly (\d+) arguments \(\d+ given\))");
-
-            ArgCountFmt fmt = ArgCountFmt::None;
-            int correctArgs = 0;
-            std::smatch match;
-
-            if (errMsg.contains(" expected at ") &&
-                errMsg.contains(" arguments, got ") &&
-                std::regex_search(errMsg, match, reAtMostLeast)) {
-                correctArgs = std::stoi(match[2]);
-                fmt = ArgCountFmt::AtMostLeast;
-            } else if (errMsg.contains(" takes from ") &&
-                       errMsg.contains(" positional arguments but ") &&
-                       std::regex_search(errMsg, match, reTakesFrom)) {
-                correctArgs = std::stoi(match[1]);
-                fmt = ArgCountFmt::TakesFrom;
-            } else if (errMsg.contains(" takes exactly ") &&
-                       errMsg.contains(" arguments (") &&
-                       std::regex_search(errMsg, match, reTakesExactly)) {
-                correctArgs = std::stoi(match[1]);
-                fmt = ArgCountFmt::TakesExactly;
-            }
+        ++maxArgs;
+        if (param.find('=') == std::string_view::npos)
+            ++minArgs;
+    }
+    facts.minArgs = minArgs;
+    facts.maxArgs = varArgs ? -1 : maxArgs;
+    return true;
+}
 
-            if (fmt != ArgCountFmt::None) {
-                const std::string &funcName =
-                    std::get<std::string>(node->fields[1].val);
-                const auto p = funcName.find('.');
-                if (p != std::string::npos) {
-                    // method call: TypeName.methodName
-                    const std::string &typeName = funcName.substr(0, p);
-                    const std::string &methodName = funcName.substr(p + 1);
-                    TypeID tid = resolveType(typeName, ctx, ast, 0);
-                    if (tid > 0) {
-                        auto &methods = tid < ctx.builtinTypesCnt
-                                            ? ctx.builtinsProps[tid]
-                                            : ast.classProps[tid];
-                        auto it = std::find_if(
-                            methods.begin(), methods.end(),
-                            [&methodName](const PropInfo &prop) {
-                                return prop.name == methodName;
-                            });
-                        if (it != methods.end()) {
-                            it->funcSig.paramTypes.resize(correctArgs);
-                            INFO("Updated method '{}' to have {} arguments",
-                                 methodName, correctArgs);
-                            handled = true;
-                        }
-                    }
-                } else {
-                    // free function — search builtins[-1]
-                    auto &funcs = ctx.builtinsProps.at(-1);
-                    auto it = std::find_if(
-                        funcs.begin(), funcs.end(),
-                        [&funcName](const PropInfo &prop) {
-                            return prop.name == funcName && prop.isCallable;
-                        });
-                    if (it != funcs.end()) {
-                        it->funcSig.paramTypes.resize(correctArgs);
-                        INFO("Updated free function '{}' to have {} arguments",
-                             funcName, correctArgs);
-                        handled = true;
-                    }
-                }
-            }
+// Positional arity from what the callable carries at C level: the code
+// object of a Python function, __text_signature__ of a builtin. Runs no
+// Python code, so it can't hang outside the watchdog. bound drops the self
+// of a function looked up on the type of an instance.
+static bool readArity(PyObject *callable, bool bound, ErrorFacts &facts) {
+    if (PyMethod_Check(callable)) {
+        callable = PyMethod_GET_FUNCTION(callable);
+        bound = true;
+    }
+    if (PyFunction_Check(callable)) {
+        const auto *code =
+            reinterpret_cast<PyCodeObject *>(PyFunction_GET_CODE(callable));
+        PyObject *defaults = PyFunction_GET_DEFAULTS(callable);
+        int32_t maxArgs = code->co_argcount;
+        int32_t minArgs =
+            maxArgs - (defaults ? PyTuple_GET_SIZE(defaults) : 0);
+        if (bound) {
+            maxArgs = std::max(maxArgs - 1, 0);
+            minArgs = std::max(minArgs - 1, 0);
         }
-        if (errMsg.contains(" attribute '") && errMsg.contains("' of '") &&
-            errMsg.contains(" objects is not writable") && !handled) {
-            // e.g. attribute 'real' of 'int' objects is not writable
-        }
-        if (errMsg.contains(" object attribute ") &&
-            errMsg.contains(" is read-only") && !handled) {
-            // e.g. 'list' object attribute 'extend' is read-only
-            std::regex regexPattern(
-                R"('(\S+)' object attribute '(\S+)' is read-only)");
-            std::smatch match;
-            if (std::regex_search(errMsg, match, regexPattern)) {
-                std::string typeName = match[1];
-                std::string attrName = match[2];
-                TypeID tid = resolveType(typeName, ctx, ast, 0);
-                if (tid > 0) {
-                    auto &props = tid < ctx.builtinTypesCnt
-                                      ? ctx.builtinsProps.at(tid)
-                                      : ast.classProps.at(tid);
-
-                    auto it = std::find_if(props.begin(), props.end(),
-                                           [&attrName](const PropInfo &prop) {
-                                               return prop.name == attrName;
-                                           });
-                    if (it != props.end()) {
-                        // mark the property as read-only
-                        it->isConst = true;
-                        INFO("Marked property '{}' as read-only for typeID {}",
-                             attrName, tid);
-                        handled = true;
-                    }
-                }
-            }
+        facts.minArgs = minArgs;
+        facts.maxArgs = code->co_flags & CO_VARARGS ? -1 : maxArgs;
+        return true;
+    }
+    // only types whose __text_signature__ is a plain C getter
+    const bool builtinType =
+        PyType_Check(callable) &&
+        !PyType_HasFeature(reinterpret_cast<PyTypeObject *>(callable),
+                           Py_TPFLAGS_HEAPTYPE);
+    if (!PyCFunction_Check(callable) && !builtinType &&
+        !Py_IS_TYPE(callable, &PyMethodDescr_Type) &&
+        !Py_IS_TYPE(callable, &PyClassMethodDescr_Type))
+        return false;
+    PyObjectPtr sig(PyObject_GetAttrString(callable, "__text_signature__"));
+    PyErr_Clear();
+    const char *str =
+        sig && PyUnicode_Check(sig.get()) ? PyUnicode_AsUTF8(sig.get())
+                                           : nullptr;
+    return str && parseTextSignature(str, facts);
+}
+
+// name in the dicts along the MRO of tp, no descriptor is invoked
+static PyObject *lookupOnType(PyTypeObject *tp, const char *name) {
+    PyObject *mro = tp->tp_mro;
+    if (!mro || !PyTuple_Check(mro))
+        return nullptr;
+    for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(mro); ++i) {
+        PyObjectPtr dict(PyType_GetDict(
+            reinterpret_cast<PyTypeObject *>(PyTuple_GET_ITEM(mro, i))));
+        if (!dict)
+            continue;
+        if (PyObject *found = PyDict_GetItemString(dict.get(), name))
+            return found;
+    }
+    return nullptr;
+}
+
+// look the line's callee up in the frame it failed in. Plain dict lookups
+// only, a getattr could run a property or __getattr__ of a generated class
+static void readCallee(PyObject *frame, const ASTNode &node,
+                       ErrorFacts &facts) {
+    auto *f = reinterpret_cast<PyFrameObject *>(frame);
+    const auto name = std::get<Symbol>(node.fields[1].val).str();
+    const auto dot = name.find('.');
+    const auto base = name.substr(0, dot);
+    PyObjectPtr globals(PyFrame_GetGlobals(f));
+    PyObjectPtr builtins(PyFrame_GetBuiltins(f));
+    PyObject *found = PyDict_GetItemString(globals.get(), base.c_str());
+    if (!found)
+        found = PyDict_GetItemString(builtins.get(), base.c_str());
+    if (!found)
+        return;
+    if (dot == std::string::npos) {
+        if (readArity(found, false, facts))
+            facts.callee = base;
+        return;
+    }
+    // unbound methods take self and module functions aren't props of a
+    // type, both are left to the message
+    const auto attr = name.substr(dot + 1);
+    if (PyType_Check(found) || PyModule_Check(found) ||
+        attr.find('.') != std::string::npos)
+        return;
+    PyObject *callee = lookupOnType(Py_TYPE(found), attr.c_str());
+    if (!callee)
+        return;
+    bool bound = true;
+    if (Py_IS_TYPE(callee, &PyStaticMethod_Type) ||
+        Py_IS_TYPE(callee, &PyClassMethod_Type)) {
+        // the wrapped function, a classmethod's cls is bound like self
+        bound = Py_IS_TYPE(callee, &PyClassMethod_Type);
+        PyObjectPtr func(PyObject_GetAttrString(callee, "__func__"));
+        PyErr_Clear();
+        if (!func || !readArity(func.get(), bound, facts))
+            return;
+    } else if (!readArity(callee, bound, facts)) {
+        return;
+    }
+    facts.ownerType = typeNameOf(found);
+    facts.callee = attr;
+}
+
+static void readErrorFacts(PyObject *exc, const std::optional<ASTNode> &node,
+                           ErrorFacts &facts) {
+    PyObjectPtr errVal(PyObject_Str(exc));
+    const char *msg = errVal ? PyUnicode_AsUTF8(errVal.get()) : nullptr;
+    facts.msg = msg ? msg : "";
+    if (PyErr_GivenExceptionMatches(exc, PyExc_AttributeError)) {
+        facts.kind = ErrorFacts::AttributeError;
+        // set together by the generic getattr, obj may legitimately be None
+        PyObjectPtr name(PyObject_GetAttrString(exc, "name"));
+        PyObjectPtr obj(PyObject_GetAttrString(exc, "obj"));
+        if (name && obj && PyUnicode_Check(name.get()) &&
+            !PyType_Check(obj.get()) && !PyModule_Check(obj.get())) {
+            facts.attr = PyUnicode_AsUTF8(name.get());
+            facts.objType = typeNameOf(obj.get());
         }
-        // TODO
+    } else if (PyErr_GivenExceptionMatches(exc, PyExc_TypeError)) {
+        facts.kind = ErrorFacts::TypeError;
+        if (node && node->kind == ASTNodeKind::Call)
+            if (auto frame = lineFrame(exc))
+                readCallee(frame.get(), *node, facts);
+    }
+    PyErr_Clear();
+}
+
+// what the repairs below work on
+struct RepairEnv {
+    AST &ast;
+    BuiltinContext &ctx;
+    const std::optional<ASTNode> &node;
+};
+
+static PropList &propsOf(RepairEnv &env, TypeID tid) {
+    return tid < env.ctx.builtinTypesCnt ? env.ctx.builtinsProps[tid]
+                                         : env.ast.classProps[tid];
+}
+
+// e.g. bad operand type for unary ~: 'str'
+static bool fixUnaryOp(RepairEnv &env, const FeedbackMatch &m) {
+    const auto opName = m.str(0);
+    const auto targetType = m.str(1);
+    auto opIt = std::find(UNARY_OPS.begin(), UNARY_OPS.end(), opName);
+    if (opIt == UNARY_OPS.end())
+        return false;
+    auto &op = env.ctx.unaryOps[opIt - UNARY_OPS.begin()];
+    auto typeIt =
+        std::find(env.ctx.types.begin(), env.ctx.types.end(), targetType);
+    if (typeIt == env.ctx.types.end())
+        return false;
+    TypeID typeID = typeIt - env.ctx.types.begin();
+    auto found = std::find(op.begin(), op.end(), typeID);
+    if (found == op.end())
+        return false;
+    op.erase(found);
+    Learned::dropUnaryOp(env.ctx, opIt - UNARY_OPS.begin(), typeID);
+    INFO("Removed typeID {} from unary op '{}'", typeID, opName);
+    return true;
+}
+
+static bool removeAttr(RepairEnv &env, const std::string &typeName,
+                       const std::string &attrName) {
+    TypeID tid = resolveType(typeName, env.ctx, env.ast, 0);
+    if (tid <= 0)
+        return false;
+    auto &props = propsOf(env, tid);
+    auto it = props.findNamed(attrName);
+    if (it == props.end())
+        return false;
+    // remove the property
+    props.erase(it);
+    if (tid < env.ctx.builtinTypesCnt)
+        env.ctx.invalidateIndex();
+    Learned::eraseProp(env.ctx, tid, attrName, false);
+    INFO("Removed property '{}' from typeID {}", attrName, tid);
+    return true;
+}
+
+// e.g. 'dict' object has no attribute 'find'
+static bool fixNoAttr(RepairEnv &env, const FeedbackMatch &m) {
+    return removeAttr(env, m.str(0), m.str(1));
+}
+
+// e.g. replace() argument 1 must be str, not None
+static bool fixArgType(RepairEnv &env, const FeedbackMatch &m) {
+    const auto funcName = m.str(0);
+    const auto argNum = m.num(1);
+    const auto expType = m.str(2);
+    if (argNum == 0)
+        return false;
+    const auto p = funcName.find('.');
+    if (p != std::string::npos) {
+        const std::string &typeName = funcName.substr(0, p);
+        const std::string &methodName = funcName.substr(p + 1);
+        TypeID tid = resolveType(typeName, env.ctx, env.ast, 0);
+        if (tid <= 0)
+            return false;
+        auto &methods = propsOf(env, tid);
+        auto it = methods.findNamed(methodName);
+        if (it == methods.end() || argNum > it->funcSig.paramTypes.size())
+            return false;
+        it->funcSig.paramTypes[argNum - 1] =
+            resolveType(expType, env.ctx, env.ast, 0);
+        Learned::setParam(env.ctx, tid, methodName, argNum - 1,
+                          it->funcSig.paramTypes[argNum - 1]);
+        INFO("Updated method '{}' for expected "
+             "type '{}'({}) for argument {}",
+             methodName, expType, tid, argNum);
+        return true;
+    }
+    // no designed parent type, we only search in builtins
+    // caused custom func should already has type.
+    auto &funcs = env.ctx.builtinsProps.at(-1);
+    auto it = funcs.findNamed(funcName);
+    if (it == funcs.end() || argNum > it->funcSig.paramTypes.size()) {
+        WARN("Failed to find function '{}' in builtins", funcName);
+        return false;
+    }
+    const auto tid = resolveType(expType, env.ctx, env.ast, 0);
+    it->funcSig.paramTypes[argNum - 1] = tid;
+    Learned::setParam(env.ctx, -1, funcName, argNum - 1, tid);
+    INFO("Updated function '{}' with expected type "
+         "'{}'({}) for "
+         "argument {}",
+         funcName, expType, tid, argNum);
+    return true;
+}
+
+static bool fixArity(RepairEnv &env, size_t correctArgs) {
+    const auto &node = env.node;
+    if (!node || node->kind != ASTNodeKind::Call)
+        return false;
+    const std::string funcName = std::get<Symbol>(node->fields[1].val).str();
+    const auto p = funcName.find('.');
+    if (p != std::string::npos) {
+        // method call: TypeName.methodName
+        const std::string &typeName = funcName.substr(0, p);
+        const std::string &methodName = funcName.substr(p + 1);
+        TypeID tid = resolveType(typeName, env.ctx, env.ast, 0);
+        if (tid <= 0)
+            return false;
+        auto &methods = propsOf(env, tid);
+        auto it = methods.findNamed(methodName);
+        if (it == methods.end())
+            return false;
+        it->funcSig.paramTypes.resize(correctArgs);
+        Learned::setArity(env.ctx, tid, methodName, correctArgs);
+        INFO("Updated method '{}' to have {} arguments", methodName,
+             correctArgs);
+        return true;
+    }
+    // free function — search builtins[-1]
+    auto &funcs = env.ctx.builtinsProps.at(-1);
+    auto it = funcs.findNamed(
+        funcName, [](const PropInfo &prop) { return prop.isCallable; });
+    if (it == funcs.end())
+        return false;
+    it->funcSig.paramTypes.resize(correctArgs);
+    Learned::setArity(env.ctx, -1, funcName, correctArgs);
+    INFO("Updated free function '{}' to have {} arguments", funcName,
+         correctArgs);
+    return true;
+}
+
+// the call has an arity the callee's signature rejects, clamp the prop's
+// parameter count into the accepted range
+static bool fixArityFrom(RepairEnv &env, const ErrorFacts &facts) {
+    if (facts.callee.empty() || !env.node)
+        return false;
+    const auto given = static_cast<int32_t>(env.node->fields.size()) - 2;
+    if (given >= facts.minArgs &&
+        (facts.maxArgs < 0 || given <= facts.maxArgs))
+        return false;
+    TypeID tid = -1;
+    PropList *props = &env.ctx.builtinsProps.at(-1);
+    if (!facts.ownerType.empty()) {
+        tid = resolveType(facts.ownerType, env.ctx, env.ast, 0);
+        if (tid <= 0)
+            return false;
+        props = &propsOf(env, tid);
+    }
+    auto it = props->findNamed(facts.callee, [](const PropInfo &prop) {
+        return prop.isCallable;
+    });
+    if (it == props->end())
+        return false;
+    // a method's paramTypes start with self, which the call doesn't pass
+    auto &params = it->funcSig.paramTypes;
+    const int32_t self = it->funcSig.selfType != -1 ? 1 : 0;
+    const auto size = static_cast<int32_t>(params.size()) - self;
+    const auto fixed =
+        std::max(facts.minArgs, facts.maxArgs < 0
+                                    ? size
+                                    : std::min(size, facts.maxArgs));
+    if (fixed == size || size < 0)
+        return false;
+    params.resize(fixed + self);
+    Learned::setArity(env.ctx, tid, facts.callee, fixed + self);
+    INFO("Updated '{}' of '{}' to have {} arguments", facts.callee,
+         facts.ownerType, fixed);
+    return true;
+}
+
+// e.g. 'list' object attribute 'extend' is read-only
+static bool fixReadOnly(RepairEnv &env, const FeedbackMatch &m) {
+    const auto attrName = m.str(1);
+    TypeID tid = resolveType(m.str(0), env.ctx, env.ast, 0);
+    if (tid <= 0)
+        return false;
+    auto &props = tid < env.ctx.builtinTypesCnt ? env.ctx.builtinsProps.at(tid)
+                                                : env.ast.classProps.at(tid);
+    auto it = props.findNamed(attrName);
+    if (it == props.end())
+        return false;
+    // mark the property as read-only
+    it->isConst = true;
+    if (tid < env.ctx.builtinTypesCnt)
+        env.ctx.invalidateIndex();
+    Learned::setConst(env.ctx, tid, attrName);
+    INFO("Marked property '{}' as read-only for typeID {}", attrName, tid);
+    return true;
+}
+
+// TypeError messages, earlier rules win when several match. Not handled
+// yet: "descriptor '__rand__' requires a 'bool' object but received a
+// 'str'" and "attribute 'real' of 'int' objects is not writable".
+static FeedbackTable<RepairEnv> typeErrorRules{
+    {"unary-op", "bad operand type for unary {s}: '{s}'", fixUnaryOp},
+    {"arg-type", "{s}() argument {d} must be {s}, not {s}", fixArgType},
+    // argument counts, three CPython formats
+    {"arity-at-most-least", "{s} expected at {w} {d} arguments, got {d}",
+     [](RepairEnv &env, const FeedbackMatch &m) {
+         return fixArity(env, m.num(2));
+     }},
+    {"arity-takes-from",
+     "{s}() takes from {d} to {d} positional arguments but {d} were given",
+     [](RepairEnv &env, const FeedbackMatch &m) {
+         return fixArity(env, m.num(1));
+     }},
+    {"arity-takes-exactly", "{s}() takes exactly {d} arguments ({d} given)",
+     [](RepairEnv &env, const FeedbackMatch &m) {
+         return fixArity(env, m.num(1));
+     }},
+    {"read-only", "'{s}' object attribute '{s}' is read-only", fixReadOnly},
+};
+
+// only used when the exception doesn't carry name and obj
+static FeedbackTable<RepairEnv> attributeErrorRules{
+    {"no-attr", "'{s}' object has no attribute '{s}'", fixNoAttr},
+};
+
+static void repairError(AST &ast, BuiltinContext &ctx,
+                        const std::optional<ASTNode> &node,
+                        const ErrorFacts &facts) {
+#ifndef DISABLE_DEBUG_OUTPUT
+    ERROR("Failed to run code: {}", facts.msg);
+#endif
+    // fix builtin sig dynamically
+    RepairEnv env{ast, ctx, node};
+    switch (facts.kind) {
+    case ErrorFacts::AttributeError:
+        if (!facts.attr.empty())
+            removeAttr(env, facts.objType, facts.attr);
+        else
+            attributeErrorRules.dispatch(facts.msg, env);
+        break;
+    case ErrorFacts::TypeError:
+        if (!fixArityFrom(env, facts))
+            typeErrorRules.dispatch(facts.msg, env);
+        break;
+    default:
+        break;
     }
+}
+
+static void repairException(AST &ast, BuiltinContext &ctx,
+                            const std::optional<ASTNode> &node,
+                            PyObject *exc) {
+    ErrorFacts facts;
+    if (exc)
+        readErrorFacts(exc, node, facts);
+    repairError(ast, ctx, node, facts);
+}
+
+static void errorCallback(AST &ast, BuiltinContext &ctx,
+                          std::optional<ASTNode> node = std::nullopt) {
+    PyObjectPtr exc(PyErr_GetRaisedException());
+    repairException(ast, ctx, node, exc.get());
     PyErr_Clear();
 }
 
@@ -538,10 +1019,15 @@ static int runInternal(const AST &ast, BuiltinContext &ctx, PyObjectPtr &code,
             outStr->assign(PyUnicode_AsUTF8(rawJson));
             return 0;
         } else {
-            set_timeout_ms(timeoutMs);
+            Watchdog::arm(timeoutMs);
             PyObjectPtr result(PyEval_EvalCode(code.get(), dict, dict));
-            clear_timeout(); // cancel timeout
-
+            Watchdog::disarm();
+            if (Watchdog::softStruck()) {
+                // interrupted, the interpreter is still usable
+                PyErr_Clear();
+                ERROR("Execution timed out");
+                return -3;
+            }
             if (!result) {
                 if (PyErr_Occurred()) {
                     ++errCnt;
@@ -551,7 +1037,7 @@ static int runInternal(const AST &ast, BuiltinContext &ctx, PyObjectPtr &code,
             return 0;
         }
     } else {
-        clear_timeout();
+        Watchdog::disarm();
         // NullStdIORedirect::restore();
         // PyErr_SetString(PyExc_RuntimeError, "Execution timed out");
         code.release();
@@ -564,6 +1050,36 @@ static int runInternal(const AST &ast, BuiltinContext &ctx, PyObjectPtr &code,
     }
 }
 
+// evaluate precompiled code objects in order under a single timeout
+static int runCodes(const std::vector<PyObject *> &codes, PyObject *dict,
+                    uint32_t timeoutMs) {
+    if (sigsetjmp(timeoutJmp, 1) == 0) {
+        Watchdog::arm(timeoutMs);
+        for (PyObject *code : codes) {
+            PyObjectPtr result(PyEval_EvalCode(code, dict, dict));
+            if (Watchdog::softStruck()) {
+                Watchdog::disarm();
+                PyErr_Clear();
+                ERROR("Execution timed out");
+                return -3;
+            }
+            if (!result && PyErr_Occurred()) {
+                Watchdog::disarm();
+                ++errCnt;
+                return -1;
+            }
+        }
+        Watchdog::disarm();
+        return 0;
+    } else {
+        Watchdog::disarm();
+        ERROR("Execution timed out, restarting Python interpreter");
+        finalize();
+        initialize(nullptr, nullptr);
+        return -2;
+    }
+}
+
 static inline int runASTStr(const std::string &re, const AST &ast,
                             BuiltinContext &ctx, PyObject *dict, bool echo,
                             uint32_t timeoutMs = 600) {
@@ -581,36 +1097,620 @@ static inline int runASTStr(const std::string &re, const AST &ast,
     return runInternal(ast, ctx, code, dict, false, nullptr, timeoutMs);
 }
 
+#ifdef FORK_SERVER
+extern "C" void __sanitizer_set_death_callback(void (*)(void));
+
+// result record sent from the forked child
+struct ForkResult {
+    int32_t ret = -1;
+    uint32_t newEdges = 0;
+    // ErrorFacts of a failed line
+    int32_t excKind = ErrorFacts::Other;
+    int32_t minArgs = -1;
+    int32_t maxArgs = -1;
+    char attr[64] = {};
+    char objType[64] = {};
+    char callee[64] = {};
+    char ownerType[64] = {};
+    char excMsg[1024] = {};
+    // set by the parent, the child died instead of answering
+    bool crashed = false;
+};
+
+// request header, a payload of size bytes follows
+struct ForkRequest {
+    enum : uint32_t { Run, Replay, Types };
+    uint32_t kind;
+    uint32_t size;
+};
+
+static void copyTruncated(char *dst, size_t cap, const char *src) {
+    if (!src)
+        return;
+    const size_t len = std::min(std::strlen(src), cap - 1);
+    std::memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+static bool sendAll(int fd, const void *buf, size_t len) {
+    const auto *p = static_cast<const char *>(buf);
+    while (len > 0) {
+        const ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool recvAll(int fd, void *buf, size_t len) {
+    auto *p = static_cast<char *>(buf);
+    while (len > 0) {
+        const ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+// 1 once fd has data, 0 on timeout, -1 on error
+static int waitReadable(int fd, uint32_t timeoutMs) {
+    pollfd pfd{fd, POLLIN, 0};
+    int ready;
+    do {
+        ready = poll(&pfd, 1, static_cast<int>(timeoutMs));
+    } while (ready < 0 && errno == EINTR);
+    return ready;
+}
+
+static void putU32(std::string &out, uint32_t v) {
+    out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+static uint32_t getU32(std::string_view in, size_t &pos) {
+    uint32_t v = 0;
+    if (pos + sizeof(v) <= in.size())
+        std::memcpy(&v, in.data() + pos, sizeof(v));
+    pos += sizeof(v);
+    return v;
+}
+
+// evaluate one marshalled code object in the child, the exception's facts
+// are read here where its objects live
+static void evalInChild(PyObject *dict, std::string_view marshalled,
+                        const std::optional<ASTNode> &node, ForkResult &out) {
+    PyObjectPtr code(PyMarshal_ReadObjectFromString(marshalled.data(),
+                                                    marshalled.size()));
+    PyObjectPtr result(
+        code ? PyEval_EvalCode(code.get(), dict, dict) : nullptr);
+    if (result) {
+        out.ret = 0;
+        return;
+    }
+    out.ret = -1;
+    PyObjectPtr exc(PyErr_GetRaisedException());
+    if (exc) {
+        ErrorFacts facts;
+        readErrorFacts(exc.get(), node, facts);
+        out.excKind = facts.kind;
+        out.minArgs = facts.minArgs;
+        out.maxArgs = facts.maxArgs;
+        copyTruncated(out.attr, sizeof(out.attr), facts.attr.c_str());
+        copyTruncated(out.objType, sizeof(out.objType), facts.objType.c_str());
+        copyTruncated(out.callee, sizeof(out.callee), facts.callee.c_str());
+        copyTruncated(out.ownerType, sizeof(out.ownerType),
+                      facts.ownerType.c_str());
+        copyTruncated(out.excMsg, sizeof(out.excMsg), facts.msg.c_str());
+    }
+    PyErr_Clear();
+}
+
+// request loop of the child, exits when the parent closes the socket
+[[noreturn]] static void serveChild(int sock, PyObject *dict) {
+    // a crash here is reported by the parent, which keeps the journal
+    __sanitizer_set_death_callback(nullptr);
+    signal(SIGINT, SIG_DFL);
+    std::string payload;
+    std::string reply;
+    while (true) {
+        ForkRequest req;
+        if (!recvAll(sock, &req, sizeof(req)))
+            _exit(0);
+        payload.resize(req.size);
+        if (!recvAll(sock, payload.data(), payload.size()))
+            _exit(0);
+        size_t pos = 0;
+        ForkResult out;
+        switch (req.kind) {
+        case ForkRequest::Run: {
+            const auto len = getU32(payload, pos);
+            const std::string_view code(payload.data() + pos, len);
+            pos += len;
+            const auto node = BinSer::decodeNode(payload, pos);
+            resetTrace();
+            evalInChild(dict, code, node, out);
+            // the seen buckets are shared, the parent only adds the count
+            out.newEdges = commitTrace();
+            break;
+        }
+        case ForkRequest::Replay:
+            out.ret = 0;
+            resetTrace();
+            while (pos < payload.size() && out.ret == 0) {
+                const auto len = getU32(payload, pos);
+                evalInChild(dict, {payload.data() + pos, len}, std::nullopt,
+                            out);
+                pos += len;
+            }
+            out.newEdges = commitTrace();
+            break;
+        case ForkRequest::Types: {
+            // tp_name only, no Python code runs
+            reply.clear();
+            PyObject *key, *value;
+            Py_ssize_t it = 0;
+            while (PyDict_Next(dict, &it, &key, &value)) {
+                if (!PyUnicode_Check(key))
+                    continue;
+                reply.append(PyUnicode_AsUTF8(key)).push_back('\0');
+                reply.append(Py_TYPE(value)->tp_name).push_back('\0');
+            }
+            const uint32_t size = reply.size();
+            if (!sendAll(sock, &size, sizeof(size)) ||
+                !sendAll(sock, reply.data(), reply.size()))
+                _exit(0);
+            continue;
+        }
+        }
+        if (!sendAll(sock, &out, sizeof(out)))
+            _exit(0);
+    }
+}
+
+int ForkServer::start(ForkResult &res) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+        PANIC("Failed to create fork server socket: {}", strerror(errno));
+    PyOS_BeforeFork();
+    const pid_t pid = fork();
+    if (pid == 0) {
+        PyOS_AfterFork_Child();
+        close(fds[0]);
+        serveChild(fds[1], dict_);
+    }
+    PyOS_AfterFork_Parent();
+    close(fds[1]);
+    if (pid < 0) {
+        close(fds[0]);
+        PANIC("Failed to fork execution child: {}", strerror(errno));
+    }
+    pid_ = pid;
+    sock_ = fds[0];
+    res.ret = 0;
+    if (committed_.empty())
+        return 0;
+    static std::string payload;
+    payload.clear();
+    for (const auto &code : committed_) {
+        putU32(payload, code.size());
+        payload.append(code);
+    }
+    // the whole history under one timeout, as runLines
+    return request(ForkRequest::Replay, payload, 2000, res);
+}
+
+void ForkServer::stop() {
+    if (pid_ < 0)
+        return;
+    kill(pid_, SIGKILL);
+    waitpid(pid_, nullptr, 0);
+    close(sock_);
+    pid_ = -1;
+    sock_ = -1;
+}
+
+// the child died on its own, the journal reproduces the line in flight
+void ForkServer::lost() {
+    int status = 0;
+    waitpid(pid_, &status, 0);
+    close(sock_);
+    pid_ = -1;
+    sock_ = -1;
+    const auto path = journalKeep();
+    ERROR("Forked child died, status={}, reproducer: {}", status, path);
+}
+
+int ForkServer::request(uint32_t kind, std::string_view payload,
+                        uint32_t timeoutMs, ForkResult &res) {
+    const ForkRequest req{kind, static_cast<uint32_t>(payload.size())};
+    if (!sendAll(sock_, &req, sizeof(req)) ||
+        !sendAll(sock_, payload.data(), payload.size())) {
+        lost();
+        res.crashed = true;
+        return -3;
+    }
+    const int ready = waitReadable(sock_, timeoutMs);
+    if (ready == 0) {
+        stop();
+        ERROR("Execution timed out, killed forked child");
+        return -3;
+    }
+    if (ready < 0 || !recvAll(sock_, &res, sizeof(res))) {
+        lost();
+        res.crashed = true;
+        return -3;
+    }
+    newEdgeCnt += res.newEdges;
+    if (res.ret == -1)
+        ++errCnt;
+    return res.ret;
+}
+
+int ForkServer::run(PyObject *code, const ASTNode &node, uint32_t timeoutMs,
+                    ForkResult &res) {
+    PyObjectPtr bytes(PyMarshal_WriteObjectToString(code, Py_MARSHAL_VERSION));
+    if (!bytes) {
+        PyErr_Clear();
+        return -1;
+    }
+    const std::string_view marshalled(PyBytes_AS_STRING(bytes.get()),
+                                      PyBytes_GET_SIZE(bytes.get()));
+    // gone after a timeout or crash the driver didn't restore from
+    if (pid_ < 0 && start(res) != 0) {
+        stop();
+        return -3;
+    }
+    static std::string payload;
+    payload.clear();
+    putU32(payload, marshalled.size());
+    payload.append(marshalled);
+    BinSer::encodeRecord(payload, node);
+    const int ret = request(ForkRequest::Run, payload, timeoutMs, res);
+    if (ret == 0)
+        pending_.emplace_back(marshalled);
+    return ret;
+}
+
+int ForkServer::replay(const std::vector<PyObject *> &codes, ForkResult &res) {
+    stop();
+    committed_.clear();
+    pending_.clear();
+    for (PyObject *code : codes) {
+        PyObjectPtr bytes(
+            PyMarshal_WriteObjectToString(code, Py_MARSHAL_VERSION));
+        if (!bytes) {
+            PyErr_Clear();
+            return -1;
+        }
+        committed_.emplace_back(PyBytes_AS_STRING(bytes.get()),
+                                PyBytes_GET_SIZE(bytes.get()));
+    }
+    const int ret = start(res);
+    if (ret != 0)
+        stop();
+    return ret;
+}
+
+bool ForkServer::types(std::string &out) {
+    if (pid_ < 0)
+        return false;
+    const ForkRequest req{ForkRequest::Types, 0};
+    uint32_t size = 0;
+    if (!sendAll(sock_, &req, sizeof(req)) ||
+        waitReadable(sock_, Latency::MAX_TIMEOUT_MS) <= 0 ||
+        !recvAll(sock_, &size, sizeof(size))) {
+        stop();
+        return false;
+    }
+    out.resize(size);
+    if (!recvAll(sock_, out.data(), out.size())) {
+        stop();
+        return false;
+    }
+    return true;
+}
+
+void ForkServer::checkpoint() {
+    for (auto &code : pending_)
+        committed_.push_back(std::move(code));
+    pending_.clear();
+}
+
+bool ForkServer::restore() {
+    stop();
+    pending_.clear();
+    ForkResult res;
+    if (start(res) == 0)
+        return true;
+    stop();
+    return false;
+}
+
+// the child's ErrorFacts, repaired exactly as if the line failed in-process
+static ErrorFacts forkedErrorFacts(const ForkResult &res) {
+    ErrorFacts facts;
+    facts.kind = static_cast<ErrorFacts::Kind>(res.excKind);
+    facts.msg = res.excMsg;
+    facts.attr = res.attr;
+    facts.objType = res.objType;
+    facts.callee = res.callee;
+    facts.ownerType = res.ownerType;
+    facts.minArgs = res.minArgs;
+    facts.maxArgs = res.maxArgs;
+    return facts;
+}
+#endif
+
 int FuzzingAST::runLine(const ASTNode &node, AST &ast, BuiltinContext &ctx,
                         std::unique_ptr<ExecutionContext> &excCtx, bool echo) {
-    std::ostringstream script;
-    nodeToPython(script, node, ast, ctx, 0);
-    const auto ret = runASTStr(
-        script.str(), ast, ctx,
-        reinterpret_cast<PyObject *>(excCtx.get()->getContext()), echo);
-    if (ret == -1)
+    TraceScope trace;
+    if (echo) {
+        CodeBuffer script;
+        nodeToPython(script, node, ast, ctx, 0);
+        std::cout << "[Generated Python]:\n" << script.str() << "\n";
+    }
+    PyErr_Clear();
+    PyObjectPtr code;
+    if (auto *cached = lineCodeCache.get(node)) {
+        ++codeCacheHits;
+        Py_INCREF(cached);
+        code.reset(cached);
+    } else {
+        ++codeCacheMisses;
+        code.reset(compileLine(node, ast, ctx));
+    }
+    int ret = -1;
+    if (!PyErr_Occurred()) {
+        const auto timeoutMs = Latency::lineTimeoutMs(node);
+        const auto start = Latency::nowNs();
+#ifdef FORK_SERVER
+        // runs only in the child, -3 leaves the child to the next restore
+        ForkResult res;
+        ret = static_cast<PythonExecutionContext &>(*excCtx).forkServer().run(
+            code.get(), node, timeoutMs, res);
+        if (!res.crashed)
+            Latency::record(node, Latency::nowNs() - start, ret == -3);
+        if (ret == -1) {
+            trace.end();
+            repairError(ast, ctx, node, forkedErrorFacts(res));
+            return ret;
+        }
+#else
+        auto *dict = reinterpret_cast<PyObject *>(excCtx->getContext());
+        ret = runInternal(ast, ctx, code, dict, false, nullptr, timeoutMs);
+        Latency::record(node, Latency::nowNs() - start, ret < -1);
+#endif
+    }
+    if (ret == 0) {
+        // will be replayed as part of the history
+        lineCodeCache.put(node, std::move(code));
+    } else if (ret == -1) {
+        trace.end();
         errorCallback(ast, ctx, std::move(node));
-    else if (ret == -2)
+    } else if (ret == -2) {
         excCtx->releasePtr();
+    }
     return ret;
 }
 
+int FuzzingAST::runBatch(const std::vector<ASTNode> &nodes, AST &ast,
+                         BuiltinContext &ctx,
+                         std::unique_ptr<ExecutionContext> &excCtx,
+                         std::vector<LineResult> &results) {
+    results.assign(nodes.size(), {});
+#ifdef FORK_SERVER
+    // one round trip to the child per line, the parent times each out
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const auto before = newEdgeCnt;
+        results[i].ret = runLine(nodes[i], ast, ctx, excCtx);
+        results[i].newEdges = newEdgeCnt - before;
+        if (results[i].ret == 0)
+            excCtx->checkpoint();
+        if (results[i].ret < -1) {
+            for (size_t j = i + 1; j < nodes.size(); ++j)
+                results[j].ret = results[i].ret;
+            return results[i].ret;
+        }
+    }
+    return 0;
+#else
+    auto *dict = reinterpret_cast<PyObject *>(excCtx.get()->getContext());
+    PyErr_Clear();
+    // compile everything up front, only evaluation runs under the timer
+    std::vector<PyObject *> codes(nodes.size(), nullptr);
+    std::vector<PyObjectPtr> compiled(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if ((codes[i] = lineCodeCache.get(nodes[i]))) {
+            ++codeCacheHits;
+            continue;
+        }
+        ++codeCacheMisses;
+        compiled[i].reset(compileLine(nodes[i], ast, ctx));
+        if (PyErr_Occurred()) {
+            results[i].ret = -1;
+            errorCallback(ast, ctx, nodes[i]);
+            continue;
+        }
+        codes[i] = compiled[i].get();
+    }
+    // raised exceptions, repaired once the watchdog is disarmed
+    std::vector<PyObjectPtr> excs(nodes.size());
+    std::vector<uint64_t> lineNs(nodes.size(), 0);
+    volatile size_t pos = 0;
+    volatile uint64_t lineStart = 0;
+    int batchRet = 0;
+    if (sigsetjmp(timeoutJmp, 1) == 0) {
+        Watchdog::arm(Latency::batchTimeoutMs(nodes));
+        while (pos < nodes.size()) {
+            if (!codes[pos]) {
+                pos = pos + 1;
+                continue;
+            }
+            resetTrace();
+            lineStart = Latency::nowNs();
+            PyObjectPtr result(PyEval_EvalCode(codes[pos], dict, dict));
+            result.reset();
+            deferAlarm = 1;
+            lineNs[pos] = Latency::nowNs() - lineStart;
+            results[pos].newEdges = commitTrace();
+            newEdgeCnt += results[pos].newEdges;
+            const bool timedOut = Watchdog::softStruck();
+            if (timedOut)
+                PyErr_Clear();
+            else if (PyErr_Occurred()) {
+                results[pos].ret = -1;
+                excs[pos].reset(PyErr_GetRaisedException());
+            } else {
+                // a timeout later in the batch rolls back to here
+                excCtx->checkpoint();
+            }
+            deferAlarm = 0;
+            if (alarmPending) {
+                alarmPending = 0;
+                siglongjmp(timeoutJmp, 1);
+            }
+            if (timedOut)
+                break;
+            pos = pos + 1;
+        }
+        Watchdog::disarm();
+        if (pos < nodes.size()) {
+            // interrupted, the interpreter is still usable
+            for (size_t i = pos; i < nodes.size(); ++i)
+                results[i].ret = -3;
+            ERROR("Execution timed out");
+            batchRet = -3;
+        }
+    } else {
+        Watchdog::disarm();
+        deferAlarm = 0;
+        alarmPending = 0;
+        Latency::record(nodes[pos], Latency::nowNs() - lineStart, true);
+        // the interpreter is restarted, nothing here can be DECREF'd
+        for (auto &exc : excs)
+            (void)exc.release();
+        for (auto &code : compiled)
+            (void)code.release();
+        for (size_t i = pos; i < nodes.size(); ++i)
+            results[i].ret = -2;
+        ERROR("Execution timed out, restarting Python interpreter");
+        finalize();
+        initialize(nullptr, nullptr);
+        excCtx->releasePtr();
+        return -2;
+    }
+    for (size_t i = 0; i < nodes.size() && i <= pos; ++i)
+        if (codes[i])
+            Latency::record(nodes[i], lineNs[i], results[i].ret == -3);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (excs[i]) {
+            ++errCnt;
+            repairException(ast, ctx, nodes[i], excs[i].get());
+        } else if (compiled[i] && results[i].ret == 0) {
+            // will be replayed as part of the history
+            lineCodeCache.put(nodes[i], std::move(compiled[i]));
+        }
+    }
+    PyErr_Clear();
+    return batchRet;
+#endif
+}
+
 int FuzzingAST::runLines(const std::vector<ASTNode> &nodes, AST &ast,
                          BuiltinContext &ctx,
                          std::unique_ptr<ExecutionContext> &excCtx, bool echo) {
-    std::ostringstream script;
-    for (auto nodeID : ast.scopes[0].declarations) {
-        const auto &node = ast.declarations[nodeID];
-        if (node.kind != ASTNodeKind::Function) {
-            nodeToPython(script, node, ast, ctx, 0);
+    TraceScope trace;
+    std::vector<PyObject *> codes;
+    codes.reserve(nodes.size() + 1);
+    PyErr_Clear();
+    {
+        static std::vector<const ASTNode *> declNodes;
+        const size_t key = declarationNodes(ast, declNodes);
+        auto it = declCodeCache.find(key);
+        const bool hit =
+            it != declCodeCache.end() &&
+            std::ranges::equal(it->second.nodes, declNodes, {}, {},
+                               [](const ASTNode *node) -> const ASTNode & {
+                                   return *node;
+                               });
+        // only rendered to compile it or to show it
+        static CodeBuffer script;
+        if (!hit || echo) {
+            script.clear();
+            for (auto nodeID : ast.scopes[0].declarations) {
+                const auto &node = ast.declarations[nodeID];
+                if (node.kind != ASTNodeKind::Function) {
+                    nodeToPython(script, node, ast, ctx, 0);
+                }
+            }
+            if (echo)
+                std::cout << "[Generated Python]:\n" << script.str() << "\n";
+        }
+        if (!hit) {
+            PyObjectPtr code(
+                Py_CompileString(script.str().c_str(), "<ast>", Py_file_input));
+            if (PyErr_Occurred()) {
+                trace.end();
+                errorCallback(ast, ctx);
+                return -1;
+            }
+            if (declCodeCache.size() >= MAX_DECL_CODE_CACHE)
+                declCodeCache.clear();
+            DeclCode decl;
+            decl.nodes.reserve(declNodes.size());
+            for (const auto *node : declNodes)
+                decl.nodes.push_back(*node);
+            decl.code = std::move(code);
+            // a colliding prefix takes the slot over
+            it = declCodeCache.insert_or_assign(key, std::move(decl)).first;
         }
+        codes.push_back(it->second.code.get());
     }
+    // codes touched here move to the front, eviction can't reach them as long
+    // as the history is shorter than the cache
     for (const auto &node : nodes) {
-        nodeToPython(script, node, ast, ctx, 0);
+        PyObject *code = lineCodeCache.get(node);
+        if (code) {
+            ++codeCacheHits;
+        } else {
+            ++codeCacheMisses;
+            PyObjectPtr compiled(compileLine(node, ast, ctx));
+            if (PyErr_Occurred()) {
+                trace.end();
+                errorCallback(ast, ctx);
+                return -1;
+            }
+            code = lineCodeCache.put(node, std::move(compiled));
+        }
+        codes.push_back(code);
     }
-    const auto ret = runASTStr(
-        script.str(), ast, ctx,
-        reinterpret_cast<PyObject *>(excCtx.get()->getContext()), echo, 2000);
+    auto *dict = reinterpret_cast<PyObject *>(excCtx->getContext());
+#ifdef FORK_SERVER
+    // only the declarations run here, they are the state the child forks
+    // from and the lines replay in it
+    auto ret = runCodes({codes.front()}, dict, 2000);
+    if (ret == 0 && codes.size() > 1) {
+        ForkResult res;
+        ret = static_cast<PythonExecutionContext &>(*excCtx)
+                  .forkServer()
+                  .replay({codes.begin() + 1, codes.end()}, res);
+        if (ret == -1) {
+            trace.end();
+            repairError(ast, ctx, std::nullopt, forkedErrorFacts(res));
+            return ret;
+        }
+    }
+#else
+    const auto ret = runCodes(codes, dict, 2000);
+#endif
+    trace.end();
     if (ret == -1)
         errorCallback(ast, ctx);
     else if (ret == -2)
@@ -620,11 +1720,14 @@ int FuzzingAST::runLines(const std::vector<ASTNode> &nodes, AST &ast,
 
 int FuzzingAST::runAST(AST &ast, BuiltinContext &ctx,
                        std::unique_ptr<ExecutionContext> &excCtx, bool echo) {
-    std::ostringstream script;
+    TraceScope trace;
+    static CodeBuffer script;
+    script.clear();
     scopeToPython(script, 0, ast, ctx, 0);
     const auto ret = runASTStr(
         script.str(), ast, ctx,
         reinterpret_cast<PyObject *>(excCtx.get()->getContext()), echo);
+    trace.end();
     if (ret == -1)
         errorCallback(ast, ctx);
     else if (ret == -2)
@@ -634,7 +1737,8 @@ int FuzzingAST::runAST(AST &ast, BuiltinContext &ctx,
 
 int FuzzingAST::reflectObject(AST &ast, ASTScope &scope, const ScopeID sid,
                               BuiltinContext &ctx) {
-    std::ostringstream script;
+    static CodeBuffer script;
+    script.clear();
 
     for (NodeID id : scope.declarations) {
         const auto &node = ast.declarations[id];
@@ -642,7 +1746,7 @@ int FuzzingAST::reflectObject(AST &ast, ASTScope &scope, const ScopeID sid,
             nodeToPython(script, ast.declarations[id], ast, ctx, 0);
     }
 
-    std::string re = script.str();
+    const std::string &re = script.str();
 
     if (re.empty())
         return 0;
@@ -669,7 +1773,7 @@ int FuzzingAST::reflectObject(AST &ast, ASTScope &scope, const ScopeID sid,
         return ret;
     }
     nlohmann::json j = nlohmann::json::parse(jsonStr);
-    std::unordered_map<TypeID, std::vector<PropInfo>> tmpMethods;
+    std::unordered_map<TypeID, PropList> tmpMethods;
     auto &funcs = j["funcs"];
 
     for (auto &[_tname, arr] : funcs.items()) {
@@ -679,7 +1783,7 @@ int FuzzingAST::reflectObject(AST &ast, ASTScope &scope, const ScopeID sid,
         else
             typeID = resolveType(_tname, ctx, ast, sid);
         if (!tmpMethods.contains(typeID))
-            tmpMethods.emplace(typeID, std::vector<PropInfo>());
+            tmpMethods.emplace(typeID, PropList());
         else
             tmpMethods[typeID].clear();
         auto &vec = tmpMethods[typeID];
@@ -738,9 +1842,43 @@ std::unique_ptr<ExecutionContext> FuzzingAST::getInitExecutionContext() {
     return std::make_unique<PythonExecutionContext>(std::move(dict));
 }
 
+static void updateType(const std::string &varName, const std::string &typeStr,
+                       ASTData &ast, BuiltinContext &ctx) {
+    if (typeStr == "object" || typeStr == "builtin_function_or_method") {
+        // callable
+        return;
+    }
+    TypeID typeID = resolveType(typeStr, ctx, ast.ast, 0);
+    if (typeID == 0) {
+        WARN("Failed to resolve type '{}' for variable '{}'", typeStr,
+             varName);
+    }
+    // update type, variables live in classProps[-1] with the scope that
+    // declared them
+    ast.ast.classProps[-1].forEachNamed(varName, [&](PropInfo &var) {
+        if (var.scope == 0)
+            var.type = typeID;
+    });
+}
+
 void FuzzingAST::updateTypes(const std::unordered_set<std::string> &globalVars,
                              ASTData &ast, BuiltinContext &ctx,
                              std::unique_ptr<ExecutionContext> &excCtx) {
+#ifdef FORK_SERVER
+    // the lines ran in the child, its globals hold the types
+    static std::string pairs;
+    if (static_cast<PythonExecutionContext &>(*excCtx).forkServer().types(
+            pairs)) {
+        for (size_t pos = 0; pos < pairs.size();) {
+            const std::string varName(pairs.c_str() + pos);
+            pos += varName.size() + 1;
+            const std::string typeStr(pairs.c_str() + pos);
+            pos += typeStr.size() + 1;
+            updateType(varName, typeStr, ast, ctx);
+        }
+        return;
+    }
+#endif
     PyObject *dict = reinterpret_cast<PyObject *>(excCtx.get()->getContext());
     // retrieve variable then get type str then match
     PyObjectPtr keys(PyDict_Keys(dict));
@@ -758,26 +1896,6 @@ void FuzzingAST::updateTypes(const std::unordered_set<std::string> &globalVars,
             ERROR("Variable '{}' not found in execution context", varName);
             continue;
         }
-        std::string typeStr(Py_TYPE(var)->tp_name);
-        if (typeStr != "object") {
-            if (typeStr == "builtin_function_or_method") {
-                // callable
-                continue;
-            }
-            TypeID typeID = resolveType(typeStr, ctx, ast.ast, 0);
-            if (typeID == 0) {
-                WARN("Failed to resolve type '{}' for variable '{}'", typeStr,
-                     varName);
-            }
-            // update type
-            for (VarID varID : ast.ast.scopes[0].variables) {
-                auto &varInfo =
-                    unfoldKey(ast.ast.variables.at(varID), ast.ast, ctx);
-                if (varInfo.name == varName) {
-                    varInfo.type = typeID;
-                    continue;
-                }
-            }
-        }
+        updateType(varName, Py_TYPE(var)->tp_name, ast, ctx);
     }
 }
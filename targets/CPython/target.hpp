@@ -4,22 +4,54 @@
 #include "ast.hpp"
 #include <Python.h>
 #include <memory>
+#include <unordered_set>
+#include <vector>
 
 namespace FuzzingAST {
 struct PyObjectDeleter {
     void operator()(PyObject *obj) const { Py_XDECREF(obj); }
 };
 using PyObjectPtr = std::unique_ptr<PyObject, PyObjectDeleter>;
+#ifdef FORK_SERVER
+class ForkServer;
+#endif
 class PythonExecutionContext : public ExecutionContext {
   public:
-    explicit PythonExecutionContext(PyObjectPtr dict)
-        : dict_(std::move(dict)) {}
+    explicit PythonExecutionContext(PyObjectPtr dict);
+    ~PythonExecutionContext() override;
 
     void *getContext() override { return dict_.get(); }
-    void releasePtr() override { dict_.release(); }
+    void releasePtr() override;
+    // undo log of the globals dict, kept by a dict watcher. Values are shared
+    // with the dict, a list the interrupted line appended to stays appended.
+    // Pays off since soft strikes keep the interpreter, a hard strike (-2)
+    // still drops it and the history is replayed. With FORK_SERVER the lines
+    // run in a child instead and the dict stays the snapshot it forks from
+    void checkpoint() override;
+    bool restore() override;
+#ifdef FORK_SERVER
+    // a fresh child replaying the checkpointed lines is the exact state
+    bool exactRestore() const override { return true; }
+    // the child the lines of this context run in, started on first use
+    ForkServer &forkServer();
+#endif
+    // called by the dict watcher before the globals dict is modified
+    void recordChange(PyDict_WatchEvent event, PyObject *key);
 
   private:
+    void clearUndoLog();
+
     PyObjectPtr dict_;
+#ifdef FORK_SERVER
+    std::unique_ptr<ForkServer> fork_;
+#endif
+    // (key, old value) pairs changed since the last checkpoint, a null value
+    // means the key didn't exist
+    std::vector<std::pair<PyObjectPtr, PyObjectPtr>> undoLog_;
+    std::unordered_set<PyObject *> loggedKeys_;
+    bool watching_ = false;
+    bool logValid_ = false;
+    bool restoring_ = false;
 };
 } // namespace FuzzingAST
 
@@ -75,14 +75,14 @@ int main(int argc, char *argv[]) {
         for (const auto &decl : ast.scopes[0].declarations) {
             const auto &node = ast.declarations[decl];
             if (node.kind != ASTNodeKind::Function) {
-                std::ostringstream script;
+                CodeBuffer script;
                 nodeToPython(script, node, ast, ctx, 0);
                 std::cout << script.str();
                 result += script.str();
             }
         }
     } else {
-        std::ostringstream script;
+        CodeBuffer script;
         scopeToPython(script, 0, ast, ctx, 0);
         std::cout << "Generated Python script:\n" << script.str() << "\n";
         result = script.str();
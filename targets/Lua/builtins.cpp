@@ -18,7 +18,7 @@ void FuzzingAST::loadBuiltinsFuncs(BuiltinContext &ctx) {
     nlohmann::json j;
     in >> j;
 
-    std::unordered_map<TypeID, std::vector<PropInfo>> tmp;
+    TypeMap<PropList> tmp;
     for (auto &bucket : j["funcs"].items()) {
         const std::string &tidStr = bucket.key();
         TypeID tid = tidStr == "-1" ? -1 : std::stoi(tidStr);
@@ -26,7 +26,7 @@ void FuzzingAST::loadBuiltinsFuncs(BuiltinContext &ctx) {
     }
     for (auto &mod : j["modules"].items()) {
         ModuleID mid = std::stoi(mod.key());
-        std::unordered_map<TypeID, std::vector<PropInfo>> modProps;
+        TypeMap<PropList> modProps;
         for (auto &bucket : mod.value().items()) {
             const std::string &tidStr = bucket.key();
             TypeID tid = tidStr == "-1" ? -1 : std::stoi(tidStr);
@@ -1,4 +1,5 @@
 #include "ast.hpp"
+#include "binser.hpp"
 #include "driver.hpp"
 #include "dumper.hpp"
 #include "serialization.hpp"
@@ -27,22 +28,30 @@ int main(int argc, char *argv[]) {
     initPrimitiveTypes(ctx);
 
     if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <path_to_json_files>\n";
+        std::cerr << "Usage: " << argv[0] << " <path_to_corpus> [--json]\n";
         return 1;
     }
     std::string path = argv[1];
+    // also export binary entries as JSON
+    const bool exportJson = argc > 2 && std::string(argv[2]) == "--json";
     for (const auto &entry : std::filesystem::directory_iterator(path)) {
-        if (entry.is_regular_file() && entry.path().extension() == ".json") {
-            std::ifstream in(entry.path());
+        const auto ext = entry.path().extension();
+        if (entry.is_regular_file() && (ext == ".json" || ext == ".bin")) {
+            std::ifstream in(entry.path(), std::ios::binary);
             if (!in) {
                 std::cerr << "Failed to open file: " << entry.path() << "\n";
                 continue;
             }
-            json j;
-            in >> j;
-            AST ast = j.get<AST>();
+            std::string content((std::istreambuf_iterator<char>(in)),
+                                std::istreambuf_iterator<char>());
+            AST ast = BinSer::parseAST(content);
+            if (exportJson && ext == ".bin") {
+                auto jsonPath = entry.path();
+                std::ofstream(jsonPath.replace_extension(".json"))
+                    << json(ast).dump();
+            }
 
-            std::ostringstream script;
+            CodeBuffer script;
             scopeToLua(script, 0, ast, ctx, 0);
 
             auto p = entry.path();
@@ -1,7 +1,7 @@
 #include "ast.hpp"
+#include "binser.hpp"
 #include "driver.hpp"
 #include "dumper.hpp"
-#include "serialization.hpp"
 #include <lua.hpp>
 #include <filesystem>
 #include <fstream>
@@ -27,7 +27,7 @@ PANIC(std::format_string<Args...> fmt, Args &&...args) {
 }
 
 static std::string readFile(const fs::path &path) {
-    std::ifstream in(path);
+    std::ifstream in(path, std::ios::binary);
     if (!in)
         throw std::runtime_error("Cannot open file: " + path.string());
     return std::string((std::istreambuf_iterator<char>(in)), {});
@@ -54,10 +54,9 @@ static void collect() {
         std::string filename = filePath.filename().string();
         try {
             std::string content = readFile(filePath);
-            nlohmann::json jsonData = nlohmann::json::parse(content);
-            AST ast = jsonData.get<AST>();
+            AST ast = BinSer::parseAST(content);
 
-            std::ostringstream script;
+            CodeBuffer script;
             scopeToLua(script, 0, ast, ctx, 0);
 
             lua_State *L = luaL_newstate();
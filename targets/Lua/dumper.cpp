@@ -20,11 +20,11 @@ static const char *mapUnaryOp(const std::string &op) {
 }
 
 // -- value helper -------------------------------------------------------------
-static void valueToLua(std::ostringstream &out, const ASTNodeValue &val,
+static void valueToLua(CodeBuffer &out, const ASTNodeValue &val,
                        const AST & /*ast*/, const BuiltinContext & /*ctx*/,
                        int /*indentLevel*/) {
-    if (std::holds_alternative<std::string>(val.val)) {
-        const auto &s = std::get<std::string>(val.val);
+    if (std::holds_alternative<Symbol>(val.val)) {
+        const auto &s = std::get<Symbol>(val.val);
         // Intercept invalid Lua constructor calls emitted by AddVariable
         // for primitive types (e.g. "None()", "nil()", "number()", "string()",
         // "boolean()", "table()", "object()").
@@ -48,23 +48,24 @@ static void valueToLua(std::ostringstream &out, const ASTNodeValue &val,
         out << (std::get<bool>(val.val) ? "true" : "false");
     } else if (std::holds_alternative<double>(val.val)) {
         out << std::get<double>(val.val);
+    } else if (std::holds_alternative<Literal>(val.val)) {
+        out << std::get<Literal>(val.val);
     } else {
         out << "nil";
     }
 }
 
 // -- node → Lua source -------------------------------------------------------
-void FuzzingAST::nodeToLua(std::ostringstream &out, const ASTNode &node,
+void FuzzingAST::nodeToLua(CodeBuffer &out, const ASTNode &node,
                            const AST &ast, const BuiltinContext &ctx,
                            int indentLevel) {
-    const std::string ind(indentLevel * 4, ' ');
-    out << ind;
+    out.indent(indentLevel);
 
     switch (node.kind) {
 
     /* -- DeclareVar ------------------------------------------------ */
     case ASTNodeKind::DeclareVar: {
-        const std::string &name = std::get<std::string>(node.fields[0].val);
+        const Symbol &name = std::get<Symbol>(node.fields[0].val);
         out << name << " = ";
         valueToLua(out, node.fields[1], ast, ctx, indentLevel);
         break;
@@ -87,7 +88,7 @@ void FuzzingAST::nodeToLua(std::ostringstream &out, const ASTNode &node,
 
     /* -- Call ------------------------------------------------------- */
     case ASTNodeKind::Call: {
-        if (!std::get<std::string>(node.fields[0].val).empty()) {
+        if (!std::get<Symbol>(node.fields[0].val).empty()) {
             valueToLua(out, node.fields[0], ast, ctx, indentLevel);
             out << " = ";
         }
@@ -108,7 +109,7 @@ void FuzzingAST::nodeToLua(std::ostringstream &out, const ASTNode &node,
         out << " = ";
         valueToLua(out, node.fields[1], ast, ctx, indentLevel);
         const char *op =
-            mapBinaryOp(std::get<std::string>(node.fields[2].val));
+            mapBinaryOp(std::get<Symbol>(node.fields[2].val).name());
         out << ' ' << op << ' ';
         valueToLua(out, node.fields[3], ast, ctx, indentLevel);
         break;
@@ -119,7 +120,7 @@ void FuzzingAST::nodeToLua(std::ostringstream &out, const ASTNode &node,
         valueToLua(out, node.fields[0], ast, ctx, indentLevel);
         out << " = ";
         const char *op =
-            mapUnaryOp(std::get<std::string>(node.fields[1].val));
+            mapUnaryOp(std::get<Symbol>(node.fields[1].val).name());
         out << op << ' ';
         valueToLua(out, node.fields[2], ast, ctx, indentLevel);
         break;
@@ -127,7 +128,7 @@ void FuzzingAST::nodeToLua(std::ostringstream &out, const ASTNode &node,
 
     /* -- Function -------------------------------------------------- */
     case ASTNodeKind::Function: {
-        const std::string &name = std::get<std::string>(node.fields[0].val);
+        const Symbol &name = std::get<Symbol>(node.fields[0].val);
 
         size_t paramCnt =
             node.fields.size() > 2 ? (node.fields.size() - 2) / 2 : 0;
@@ -136,22 +137,22 @@ void FuzzingAST::nodeToLua(std::ostringstream &out, const ASTNode &node,
         for (size_t i = 0; i < paramCnt; ++i) {
             if (i)
                 out << ", ";
-            out << std::get<std::string>(node.fields[2 + i * 2].val);
+            out << std::get<Symbol>(node.fields[2 + i * 2].val);
         }
         out << ")\n";
 
         scopeToLua(out, node.scope, ast, ctx, indentLevel + 1);
 
-        out << ind << "end";
+        out.indent(indentLevel) << "end";
         break;
     }
 
     /* -- Class  (metatable-based OOP) ------------------------------ */
     case ASTNodeKind::Class: {
-        const std::string &name = std::get<std::string>(node.fields[0].val);
+        const Symbol &name = std::get<Symbol>(node.fields[0].val);
 
         // collect bases up to the -1 sentinel
-        std::vector<std::string> bases;
+        std::vector<Symbol> bases;
         size_t idx = 1;
         for (; idx < node.fields.size(); ++idx) {
             if (std::holds_alternative<int64_t>(node.fields[idx].val) &&
@@ -160,7 +161,7 @@ void FuzzingAST::nodeToLua(std::ostringstream &out, const ASTNode &node,
                 break;
             }
             const auto &baseName =
-                std::get<std::string>(node.fields[idx].val);
+                std::get<Symbol>(node.fields[idx].val);
             // Skip primitive type names that aren't valid Lua tables.
             // "number", "boolean", "nil", "string", "object", "math" cannot
             // be used as __index bases — only user-defined class names and
@@ -176,13 +177,13 @@ void FuzzingAST::nodeToLua(std::ostringstream &out, const ASTNode &node,
         // Collect metamethod names from member functions.
         // Lua metamethods (__len, __add, __eq, etc.) must be set in the
         // instance metatable, not just on the class table.
-        std::vector<std::string> metamethodNames;
+        std::vector<std::string_view> metamethodNames;
         for (size_t i = idx; i < node.fields.size(); ++i) {
             NodeID fnID =
                 static_cast<NodeID>(std::get<int64_t>(node.fields[i].val));
             const auto &fn = ast.declarations[fnID];
             const std::string &fnName =
-                std::get<std::string>(fn.fields[0].val);
+                std::get<Symbol>(fn.fields[0].val).name();
             // metamethods start with __ but exclude __init__ and __index
             if (fnName.size() > 2 && fnName[0] == '_' && fnName[1] == '_' &&
                 fnName != "__init__" && fnName != "__index") {
@@ -196,20 +197,20 @@ void FuzzingAST::nodeToLua(std::ostringstream &out, const ASTNode &node,
             out << "__index = " << bases[0];
         }
         out << ",\n";
-        out << ind << "    __call = function(cls, ...)\n";
+        out.indent(indentLevel) << "    __call = function(cls, ...)\n";
         // Build instance metatable with __index and any metamethods
-        out << ind << "        local mt = {__index = cls";
+        out.indent(indentLevel) << "        local mt = {__index = cls";
         for (const auto &mm : metamethodNames) {
             out << ", " << mm << " = cls." << mm;
         }
         out << "}\n";
-        out << ind << "        local self = setmetatable({}, mt)\n";
-        out << ind
+        out.indent(indentLevel) << "        local self = setmetatable({}, mt)\n";
+        out.indent(indentLevel)
             << "        if cls.__init__ then cls.__init__(self, ...) end\n";
-        out << ind << "        return self\n";
-        out << ind << "    end\n";
-        out << ind << "})\n";
-        out << ind << name << ".__index = " << name;
+        out.indent(indentLevel) << "        return self\n";
+        out.indent(indentLevel) << "    end\n";
+        out.indent(indentLevel) << "})\n";
+        out.indent(indentLevel) << name << ".__index = " << name;
 
         // emit member functions
         for (; idx < node.fields.size(); ++idx) {
@@ -218,7 +219,7 @@ void FuzzingAST::nodeToLua(std::ostringstream &out, const ASTNode &node,
             out << '\n';
             const auto &fn = ast.declarations[fnID];
             const std::string &fnName =
-                std::get<std::string>(fn.fields[0].val);
+                std::get<Symbol>(fn.fields[0].val).name();
 
             // emit as ClassName:method(...)  — self is implicit via ':'
             size_t pCnt =
@@ -226,17 +227,17 @@ void FuzzingAST::nodeToLua(std::ostringstream &out, const ASTNode &node,
             // Skip 'self' parameter (first param) in the signature since
             // ':' syntax provides it implicitly
             bool hasSelf = (pCnt > 0 &&
-                std::get<std::string>(fn.fields[2].val) == "self");
+                std::get<Symbol>(fn.fields[2].val) == "self");
             size_t startParam = hasSelf ? 1 : 0;
-            out << ind << "function " << name << ":" << fnName << "(";
+            out.indent(indentLevel) << "function " << name << ":" << fnName << "(";
             for (size_t p = startParam; p < pCnt; ++p) {
                 if (p > startParam)
                     out << ", ";
-                out << std::get<std::string>(fn.fields[2 + p * 2].val);
+                out << std::get<Symbol>(fn.fields[2 + p * 2].val);
             }
             out << ")\n";
             scopeToLua(out, fn.scope, ast, ctx, indentLevel + 1);
-            out << ind << "end";
+            out.indent(indentLevel) << "end";
         }
         break;
     }
@@ -248,7 +249,7 @@ void FuzzingAST::nodeToLua(std::ostringstream &out, const ASTNode &node,
 
     /* -- Import ---------------------------------------------------- */
     case ASTNodeKind::Import: {
-        const std::string &mod = std::get<std::string>(node.fields[0].val);
+        const Symbol &mod = std::get<Symbol>(node.fields[0].val);
         // make the module table available as a global with its name
         out << mod << " = require(\"" << mod << "\")";
         break;
@@ -286,12 +287,12 @@ void FuzzingAST::nodeToLua(std::ostringstream &out, const ASTNode &node,
 }
 
 // -- scope → Lua source ------------------------------------------------------
-void FuzzingAST::scopeToLua(std::ostringstream &out, ScopeID sid,
+void FuzzingAST::scopeToLua(CodeBuffer &out, ScopeID sid,
                             const AST &ast, const BuiltinContext &ctx,
                             int indentLevel) {
     if (sid == -1)
         return;
-    out << std::string(indentLevel * 4, ' ') << "-- scope " << sid << '\n';
+    out.indent(indentLevel) << "-- scope " << sid << '\n';
     const ASTScope &scope = ast.scopes[sid];
     bool empty = true;
 
@@ -325,5 +326,5 @@ void FuzzingAST::scopeToLua(std::ostringstream &out, ScopeID sid,
     }
 
     if (empty)
-        out << std::string(indentLevel * 4, ' ') << "-- (empty scope)\n";
+        out.indent(indentLevel) << "-- (empty scope)\n";
 }
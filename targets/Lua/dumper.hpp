@@ -2,12 +2,12 @@
 #define LUA_DUMPER_HPP
 
 #include "ast.hpp"
-#include <sstream>
+#include "codebuf.hpp"
 
 namespace FuzzingAST {
-void nodeToLua(std::ostringstream &out, const ASTNode &node, const AST &ast,
+void nodeToLua(CodeBuffer &out, const ASTNode &node, const AST &ast,
                const BuiltinContext &ctx, int indentLevel);
-void scopeToLua(std::ostringstream &out, ScopeID sid, const AST &ast,
+void scopeToLua(CodeBuffer &out, ScopeID sid, const AST &ast,
                 const BuiltinContext &ctx, int indentLevel);
 } // namespace FuzzingAST
 
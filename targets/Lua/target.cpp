@@ -1,18 +1,20 @@
 #include "target.hpp"
 #include "ast.hpp"
+#include "coverage.hpp"
 #include "driver.hpp"
 #include "dumper.hpp"
+#include "feedback.hpp"
+#include "latency.hpp"
+#include "learned.hpp"
 #include "log.hpp"
+#include "watchdog.hpp"
 #include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
 #include <iostream>
-#include <regex>
 #include <serialization.hpp>
 #include <setjmp.h>
 #include <signal.h>
-#include <sstream>
-#include <sys/time.h>
 #include <unistd.h>
 #include <unordered_set>
 
@@ -29,19 +31,11 @@ static int oldStderr = dup(STDERR_FILENO);
 // -- SanitizerCoverage hooks -------------------------------------------------
 extern "C" void __sanitizer_cov_trace_pc_guard_init(uint32_t *start,
                                                     uint32_t *stop) {
-    if (start == stop || *start)
-        return;
-    static uint32_t N = 0;
-    for (uint32_t *x = start; x < stop; ++x) {
-        *x = ++N;
-    }
+    registerGuards(start, stop);
 }
 
 extern "C" void __sanitizer_cov_trace_pc_guard(uint32_t *guard) {
-    if (!*guard)
-        return;
-    newEdgeCnt++;
-    *guard = 0;
+    traceEdge(*guard);
 }
 
 // -- Redirect stdout/stderr to /dev/null -------------------------------------
@@ -59,24 +53,32 @@ class NullStdIORedirect {
     }
 };
 
-// -- Timeout handling (SIGALRM + siglongjmp) ---------------------------------
-static void alarmHandler(int signum) {
-    if (signum == SIGALRM) {
-        siglongjmp(timeoutJmp, 1);
-    }
-}
-
-static void set_timeout_ms(int timeout_ms) {
-    struct itimerval timer{};
-    timer.it_value.tv_sec = timeout_ms / 1000;
-    timer.it_value.tv_usec = (timeout_ms % 1000) * 1000;
-    timer.it_interval = {};
-    setitimer(ITIMER_REAL, &timer, nullptr);
+// -- Timeout handling (watchdog) --------------------------------------------
+// Every state carries a count hook that raises a Lua error once the watchdog
+// struck the execution in flight, which unwinds through the VM and leaves the
+// state usable. It raises again each time it fires, a pcall can't hold on to
+// the execution. Code stuck in C never reaches the hook, the hard strike's
+// SIGALRM then siglongjmps out and the state is dropped.
+static constexpr int HOOK_COUNT = 1000;
+// set while runBatch updates its own state between two lines, a hard strike
+// arriving then is taken once the state is consistent again
+static volatile sig_atomic_t deferAlarm = 0;
+static volatile sig_atomic_t alarmPending = 0;
+
+static void timeoutHook(lua_State *L, lua_Debug * /*ar*/) {
+    if (Watchdog::armed() && Watchdog::softStruck())
+        luaL_error(L, "execution timed out");
 }
 
-static void clear_timeout() {
-    struct itimerval zero{};
-    setitimer(ITIMER_REAL, &zero, nullptr);
+static void alarmHandler(int signum) {
+    // a strike for an execution that already ended
+    if (signum != SIGALRM || !Watchdog::armed() || !Watchdog::hardStruck())
+        return;
+    if (deferAlarm) {
+        alarmPending = 1;
+        return;
+    }
+    siglongjmp(timeoutJmp, 1);
 }
 
 static void installSignalHandler() {
@@ -94,12 +96,14 @@ static void installSignalHandler() {
 static lua_State *newLuaState() {
     lua_State *L = luaL_newstate();
     luaL_openlibs(L);
+    lua_sethook(L, timeoutHook, LUA_MASKCOUNT, HOOK_COUNT);
     return L;
 }
 
 // -- Target interface --------------------------------------------------------
 int FuzzingAST::initialize(int * /*argc*/, char *** /*argv*/) {
     installSignalHandler();
+    Watchdog::start(nullptr); // the count hook polls
     return 0;
 }
 
@@ -143,18 +147,20 @@ void FuzzingAST::dummyAST(ASTData &data, const BuiltinContext &ctx) {
     data.ast.declarations[10] =
         ASTNode{ASTNodeKind::DeclareVar, {{"tbl_d"}, {"{a=1, b=2, c=3}"}}};  // dict-like table
 
-    data.ast.classProps[-1].resize(NUM_SEED);
-    data.ast.classProps[-1][0] = PropInfo{ctx.strID,   0, "str_a",  false};
-    data.ast.classProps[-1][1] = PropInfo{ctx.strID,   0, "str_b",  false};
-    data.ast.classProps[-1][2] = PropInfo{ctx.intID,   0, "num_a",  false};
-    data.ast.classProps[-1][3] = PropInfo{ctx.intID,   0, "num_b",  false};
-    data.ast.classProps[-1][4] = PropInfo{ctx.floatID, 0, "num_c",  false};
-    data.ast.classProps[-1][5] = PropInfo{ctx.boolID,  0, "bool_a", false};
-    data.ast.classProps[-1][6] = PropInfo{ctx.boolID,  0, "bool_b", false};
-    data.ast.classProps[-1][7] = PropInfo{tableType,   0, "tbl_a",  false};
-    data.ast.classProps[-1][8] = PropInfo{tableType,   0, "tbl_b",  false};
-    data.ast.classProps[-1][9] = PropInfo{tableType,   0, "tbl_c",  false};
-    data.ast.classProps[-1][10] = PropInfo{tableType,  0, "tbl_d",  false};
+    // assigned as a whole, names can't change once the list indexed them
+    data.ast.classProps[-1] = std::vector<PropInfo>{
+        PropInfo{ctx.strID,   0, "str_a",  false},
+        PropInfo{ctx.strID,   0, "str_b",  false},
+        PropInfo{ctx.intID,   0, "num_a",  false},
+        PropInfo{ctx.intID,   0, "num_b",  false},
+        PropInfo{ctx.floatID, 0, "num_c",  false},
+        PropInfo{ctx.boolID,  0, "bool_a", false},
+        PropInfo{ctx.boolID,  0, "bool_b", false},
+        PropInfo{tableType,   0, "tbl_a",  false},
+        PropInfo{tableType,   0, "tbl_b",  false},
+        PropInfo{tableType,   0, "tbl_c",  false},
+        PropInfo{tableType,  0, "tbl_d",  false},
+    };
 
     data.ast.variables.resize(NUM_SEED);
     for (int i = 0; i < NUM_SEED; ++i) {
@@ -165,187 +171,185 @@ void FuzzingAST::dummyAST(ASTData &data, const BuiltinContext &ctx) {
 }
 
 // -- Error callback — dynamically fix builtins from Lua errors ---------------
-static void errorCallback(const std::string &errMsg, AST &ast,
-                          BuiltinContext &ctx,
-                          std::optional<ASTNode> node = std::nullopt) {
-#ifndef DISABLE_DEBUG_OUTPUT
-    ERROR("Lua error: {}", errMsg);
-#endif
+struct RepairEnv {
+    AST &ast;
+    BuiltinContext &ctx;
+    const std::optional<ASTNode> &node;
+};
 
-    /* --- "bad argument #N to 'func' (type expected, got type)" ------ */
-    {
-        static const std::regex reBadArg(
-            R"(bad argument #(\d+) to '([^']+)' \((\w+) expected, got (\w+)\))");
-        std::smatch m;
-        if (std::regex_search(errMsg, m, reBadArg)) {
-            size_t argNum = std::stoul(m[1]);
-            std::string funcName = m[2];
-            std::string expType = m[3];
-
-            TypeID expTid = resolveType(expType, ctx, ast, 0);
-
-            // try dotted name first  (e.g. "upper" from string.upper)
-            const auto dot = funcName.find('.');
-            if (dot != std::string::npos) {
-                std::string typeName = funcName.substr(0, dot);
-                std::string methodName = funcName.substr(dot + 1);
-                TypeID tid = resolveType(typeName, ctx, ast, 0);
-                if (tid > 0) {
-                    auto &methods = tid < static_cast<TypeID>(ctx.builtinTypesCnt)
-                                        ? ctx.builtinsProps[tid]
-                                        : ast.classProps[tid];
-                    for (auto &pi : methods) {
-                        if (pi.name == methodName && pi.isCallable &&
-                            argNum - 1 < pi.funcSig.paramTypes.size()) {
-                            pi.funcSig.paramTypes[argNum - 1] = expTid;
-                            return;
-                        }
-                    }
-                }
-            }
-            // global function
-            auto &globals = ctx.builtinsProps[-1];
-            for (auto &pi : globals) {
-                if (pi.name == funcName && pi.isCallable &&
-                    argNum - 1 < pi.funcSig.paramTypes.size()) {
-                    pi.funcSig.paramTypes[argNum - 1] = expTid;
-                    return;
-                }
-            }
+// drop badTid from the given binary op rows, both as LHS and RHS
+static void dropFromOps(RepairEnv &env, TypeID badTid, int first, int last) {
+    auto &ops = env.ctx.ops;
+    for (int opIdx = first; opIdx <= last && opIdx < (int)ops.size(); ++opIdx) {
+        auto &row = ops[opIdx];
+        if (badTid < (TypeID)row.size()) {
+            row[badTid].clear();
         }
-    }
-
-    /* --- "attempt to perform arithmetic on a <type> value" -------- */
-    {
-        static const std::regex reArith(
-            R"(attempt to perform arithmetic on a (\w+) value)");
-        std::smatch m;
-        if (std::regex_search(errMsg, m, reArith)) {
-            TypeID badTid = resolveType(m[1], ctx, ast, 0);
-            if (badTid > 0) {
-                // remove this type from arithmetic ops (ops 0-6: + - * / % ** //)
-                for (int opIdx = 0; opIdx < 7 && opIdx < (int)ctx.ops.size(); ++opIdx) {
-                    auto &row = ctx.ops[opIdx];
-                    if (badTid < (TypeID)row.size()) {
-                        row[badTid].clear();
-                    }
-                    // also remove as RHS partner
-                    for (auto &compat : row) {
-                        compat.erase(
-                            std::remove(compat.begin(), compat.end(), badTid),
-                            compat.end());
-                    }
-                }
-            }
-            return;
+        // also remove as RHS partner
+        for (auto &compat : row) {
+            compat.erase(std::remove(compat.begin(), compat.end(), badTid),
+                         compat.end());
         }
+        Learned::dropBinaryOp(env.ctx, opIdx, badTid);
     }
+}
 
-    /* --- "attempt to compare two <type> values" ------------------- */
-    {
-        static const std::regex reCmp(
-            R"(attempt to compare two (\w+) values)");
-        std::smatch m;
-        if (std::regex_search(errMsg, m, reCmp)) {
-            TypeID badTid = resolveType(m[1], ctx, ast, 0);
-            if (badTid > 0) {
-                // remove from comparison ops (ops 9-12: < > <= >=)
-                for (int opIdx = 9; opIdx <= 12 && opIdx < (int)ctx.ops.size(); ++opIdx) {
-                    auto &row = ctx.ops[opIdx];
-                    if (badTid < (TypeID)row.size()) {
-                        row[badTid].clear();
-                    }
-                    for (auto &compat : row) {
-                        compat.erase(
-                            std::remove(compat.begin(), compat.end(), badTid),
-                            compat.end());
-                    }
-                }
+/* --- "bad argument #N to 'func' (type expected, got type)" ------ */
+static bool fixBadArg(RepairEnv &env, const FeedbackMatch &m) {
+    auto &[ast, ctx, node] = env;
+    size_t argNum = m.num(0);
+    std::string funcName = m.str(1);
+    if (argNum == 0)
+        return false;
+    TypeID expTid = resolveType(m.str(2), ctx, ast, 0);
+    auto fits = [argNum](const PropInfo &pi) {
+        return pi.isCallable && argNum - 1 < pi.funcSig.paramTypes.size();
+    };
+
+    // try dotted name first  (e.g. "upper" from string.upper)
+    const auto dot = funcName.find('.');
+    if (dot != std::string::npos) {
+        std::string typeName = funcName.substr(0, dot);
+        std::string methodName = funcName.substr(dot + 1);
+        TypeID tid = resolveType(typeName, ctx, ast, 0);
+        if (tid > 0) {
+            auto &methods = tid < static_cast<TypeID>(ctx.builtinTypesCnt)
+                                ? ctx.builtinsProps[tid]
+                                : ast.classProps[tid];
+            auto it = methods.findNamed(methodName, fits);
+            if (it != methods.end()) {
+                it->funcSig.paramTypes[argNum - 1] = expTid;
+                Learned::setParam(ctx, tid, methodName, argNum - 1, expTid);
+                return true;
             }
-            return;
         }
     }
+    // global function
+    auto &globals = ctx.builtinsProps[-1];
+    auto it = globals.findNamed(funcName, fits);
+    if (it == globals.end())
+        return false;
+    it->funcSig.paramTypes[argNum - 1] = expTid;
+    Learned::setParam(ctx, -1, funcName, argNum - 1, expTid);
+    return true;
+}
 
-    /* --- "attempt to call a <type> value" ------------------------- */
-    {
-        static const std::regex reCall(
-            R"(attempt to call a (\w+) value)");
-        std::smatch m;
-        if (std::regex_search(errMsg, m, reCall)) {
-            // Extract the called name from the node if available
-            if (node && node->kind == ASTNodeKind::Call &&
-                node->fields.size() >= 2) {
-                std::string callName =
-                    std::get<std::string>(node->fields[1].val);
-                // Try to find and mark as non-callable
-                auto dot = callName.rfind('.');
-                if (dot != std::string::npos) {
-                    std::string typeName = callName.substr(0, dot);
-                    std::string methodName = callName.substr(dot + 1);
-                    TypeID tid = resolveType(typeName, ctx, ast, 0);
-                    auto removeCallable = [&](std::vector<PropInfo> &props) {
-                        for (auto it = props.begin(); it != props.end(); ++it) {
-                            if (it->name == methodName && it->isCallable) {
-                                props.erase(it);
-                                return true;
-                            }
-                        }
-                        return false;
-                    };
-                    if (ctx.builtinsProps.contains(tid))
-                        removeCallable(ctx.builtinsProps[tid]);
-                    else if (ast.classProps.contains(tid))
-                        removeCallable(ast.classProps[tid]);
-                }
-            }
-            return;
-        }
-    }
+/* --- "attempt to perform arithmetic on a <type> value" -------- */
+static bool fixArith(RepairEnv &env, const FeedbackMatch &m) {
+    TypeID badTid = resolveType(m.str(0), env.ctx, env.ast, 0);
+    if (badTid <= 0)
+        return false;
+    // remove this type from arithmetic ops (ops 0-6: + - * / % ** //)
+    dropFromOps(env, badTid, 0, 6);
+    return true;
+}
 
-    /* --- "attempt to index a <type> value" ------------------------ */
-    {
-        static const std::regex reIndex(
-            R"(attempt to index a (\w+) value)");
-        std::smatch m;
-        if (std::regex_search(errMsg, m, reIndex)) {
-            // The type shouldn't have properties — remove all props
-            TypeID badTid = resolveType(m[1], ctx, ast, 0);
-            if (badTid > 0 && badTid != resolveType("table", ctx, ast, 0)) {
-                if (ctx.builtinsProps.contains(badTid))
-                    ctx.builtinsProps.erase(badTid);
-                if (ast.classProps.contains(badTid))
-                    ast.classProps.erase(badTid);
-            }
-            return;
-        }
+/* --- "attempt to compare two <type> values" ------------------- */
+static bool fixCompare(RepairEnv &env, const FeedbackMatch &m) {
+    TypeID badTid = resolveType(m.str(0), env.ctx, env.ast, 0);
+    if (badTid <= 0)
+        return false;
+    // remove from comparison ops (ops 9-12: < > <= >=)
+    dropFromOps(env, badTid, 9, 12);
+    return true;
+}
+
+/* --- "attempt to call a <type> value" ------------------------- */
+static bool fixCall(RepairEnv &env, const FeedbackMatch &) {
+    auto &[ast, ctx, node] = env;
+    // Extract the called name from the node if available
+    if (!node || node->kind != ASTNodeKind::Call || node->fields.size() < 2)
+        return false;
+    std::string callName = std::get<Symbol>(node->fields[1].val).str();
+    // Try to find and mark as non-callable
+    auto dot = callName.rfind('.');
+    if (dot == std::string::npos)
+        return false;
+    std::string typeName = callName.substr(0, dot);
+    std::string methodName = callName.substr(dot + 1);
+    TypeID tid = resolveType(typeName, ctx, ast, 0);
+    auto removeCallable = [&](PropList &props) {
+        auto it = props.findNamed(
+            methodName, [](const PropInfo &pi) { return pi.isCallable; });
+        if (it == props.end())
+            return false;
+        props.erase(it);
+        return true;
+    };
+    if (ctx.builtinsProps.contains(tid)) {
+        if (!removeCallable(ctx.builtinsProps[tid]))
+            return false;
+        ctx.invalidateIndex();
+        Learned::eraseProp(ctx, tid, methodName, true);
+        return true;
     }
+    return ast.classProps.contains(tid) && removeCallable(ast.classProps[tid]);
+}
 
-    /* --- "expected at most/least N arguments" ---------------------- */
-    {
-        static const std::regex reArgCnt(
-            R"((\w+) expected at most (\d+) arguments?, got (\d+))");
-        std::smatch m;
-        if (std::regex_search(errMsg, m, reArgCnt)) {
-            std::string funcName = m[1];
-            size_t expectedMax = std::stoul(m[2]);
-            // shrink parameter list to expectedMax
-            auto shrink = [&](std::vector<PropInfo> &props) {
-                for (auto &pi : props) {
-                    if (pi.name == funcName && pi.isCallable &&
-                        pi.funcSig.paramTypes.size() > expectedMax) {
-                        pi.funcSig.paramTypes.resize(expectedMax);
-                        return true;
-                    }
-                }
-                return false;
-            };
-            if (!shrink(ctx.builtinsProps[-1])) {
-                for (auto &[tid, props] : ctx.builtinsProps)
-                    if (shrink(props)) break;
-            }
-            return;
-        }
+/* --- "attempt to index a <type> value" ------------------------ */
+static bool fixIndex(RepairEnv &env, const FeedbackMatch &m) {
+    auto &[ast, ctx, node] = env;
+    // The type shouldn't have properties — remove all props
+    TypeID badTid = resolveType(m.str(0), ctx, ast, 0);
+    if (badTid <= 0 || badTid == resolveType("table", ctx, ast, 0))
+        return false;
+    bool fixed = false;
+    if (ctx.builtinsProps.contains(badTid)) {
+        ctx.builtinsProps.erase(badTid);
+        ctx.invalidateIndex();
+        Learned::dropType(ctx, badTid);
+        fixed = true;
     }
+    if (ast.classProps.contains(badTid)) {
+        ast.classProps.erase(badTid);
+        fixed = true;
+    }
+    return fixed;
+}
+
+/* --- "expected at most N arguments" ---------------------------- */
+static bool fixArgCount(RepairEnv &env, const FeedbackMatch &m) {
+    auto &ctx = env.ctx;
+    std::string funcName = m.str(0);
+    size_t expectedMax = m.num(1);
+    // shrink parameter list to expectedMax
+    auto shrink = [&](TypeID tid, PropList &props) {
+        auto it = props.findNamed(funcName, [&](const PropInfo &pi) {
+            return pi.isCallable && pi.funcSig.paramTypes.size() > expectedMax;
+        });
+        if (it == props.end())
+            return false;
+        it->funcSig.paramTypes.resize(expectedMax);
+        Learned::setArity(ctx, tid, funcName, expectedMax);
+        return true;
+    };
+    if (shrink(-1, ctx.builtinsProps[-1]))
+        return true;
+    for (auto &[tid, props] : ctx.builtinsProps)
+        if (shrink(tid, props))
+            return true;
+    return false;
+}
+
+// earlier rules win when several match
+static FeedbackTable<RepairEnv> luaErrorRules{
+    {"bad-arg", "bad argument #{d} to '{q}' ({w} expected, got {w})",
+     fixBadArg},
+    {"arith", "attempt to perform arithmetic on a {w} value", fixArith},
+    {"compare", "attempt to compare two {w} values", fixCompare},
+    {"call", "attempt to call a {w} value", fixCall},
+    {"index", "attempt to index a {w} value", fixIndex},
+    {"arg-count", "{w} expected at most {d} argument", fixArgCount},
+};
+
+static void errorCallback(const std::string &errMsg, AST &ast,
+                          BuiltinContext &ctx,
+                          std::optional<ASTNode> node = std::nullopt) {
+#ifndef DISABLE_DEBUG_OUTPUT
+    ERROR("Lua error: {}", errMsg);
+#endif
+    RepairEnv env{ast, ctx, node};
+    luaErrorRules.dispatch(errMsg, env);
 }
 
 // -- Execute a Lua string in state L -----------------------------------------
@@ -357,11 +361,21 @@ static int runLuaStr(lua_State *L, const std::string &code, AST &ast,
         std::cout << "[Generated Lua]:\n" << code << "\n";
     }
 
+    const auto start = Latency::nowNs();
     if (sigsetjmp(timeoutJmp, 1) == 0) {
-        set_timeout_ms(timeoutMs);
+        Watchdog::arm(timeoutMs);
         int ret = luaL_dostring(L, code.c_str());
-        clear_timeout();
-
+        Watchdog::disarm();
+        if (node)
+            Latency::record(*node, Latency::nowNs() - start,
+                            Watchdog::softStruck());
+
+        if (Watchdog::softStruck()) {
+            if (ret != LUA_OK)
+                lua_pop(L, 1);
+            ERROR("Lua execution timed out");
+            return -3;
+        }
         if (ret != LUA_OK) {
             ++errCnt;
             std::string errMsg;
@@ -373,28 +387,188 @@ static int runLuaStr(lua_State *L, const std::string &code, AST &ast,
         }
         return 0;
     } else {
-        clear_timeout();
+        Watchdog::disarm();
+        if (node)
+            Latency::record(*node, Latency::nowNs() - start, true);
         ERROR("Lua execution timed out");
         return -2;
     }
 }
 
+// -- Checkpoint / restore of the global table --------------------------------
+void LuaExecutionContext::checkpoint() {
+    lua_State *L = state_.get();
+    if (!L)
+        return;
+    if (checkpointRef_ == LUA_NOREF) {
+        lua_newtable(L);
+        checkpointRef_ = luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+    // the snapshot is synced in place, only globals that changed since the
+    // last checkpoint are written and nothing is allocated otherwise
+    lua_pushglobaltable(L);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, checkpointRef_);
+    lua_pushnil(L);
+    while (lua_next(L, -2) != 0) { // G, snap, k, v
+        lua_pop(L, 1);
+        lua_pushvalue(L, -1);
+        if (lua_rawget(L, -4) == LUA_TNIL) {
+            lua_pushvalue(L, -2);
+            lua_pushnil(L);
+            lua_rawset(L, -5); // snap[k] = nil
+        }
+        lua_pop(L, 1);
+    }
+    lua_pushnil(L);
+    while (lua_next(L, -3) != 0) { // G, snap, k, v
+        lua_pushvalue(L, -2);
+        lua_rawget(L, -4);
+        if (lua_rawequal(L, -1, -2)) {
+            lua_pop(L, 2);
+            continue;
+        }
+        lua_pop(L, 1);
+        lua_pushvalue(L, -2);
+        lua_insert(L, -2);
+        lua_rawset(L, -4); // snap[k] = v
+    }
+    lua_pop(L, 2);
+}
+
+bool LuaExecutionContext::restore() {
+    lua_State *L = state_.get();
+    if (!L || checkpointRef_ == LUA_NOREF)
+        return false;
+    lua_settop(L, 0);
+    lua_pushglobaltable(L);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, checkpointRef_);
+    // drop globals defined after the checkpoint, clearing existing fields
+    // during traversal is allowed
+    lua_pushnil(L);
+    while (lua_next(L, 1) != 0) { // G, snap, k, v
+        lua_pop(L, 1);
+        lua_pushvalue(L, -1);
+        if (lua_rawget(L, 2) == LUA_TNIL) {
+            lua_pushvalue(L, -2);
+            lua_pushnil(L);
+            lua_rawset(L, 1); // G[k] = nil
+        }
+        lua_pop(L, 1);
+    }
+    lua_pushnil(L);
+    while (lua_next(L, 2) != 0) { // G, snap, k, v
+        lua_pushvalue(L, -2);
+        lua_insert(L, -2);
+        lua_rawset(L, 1); // G[k] = snap[k]
+    }
+    lua_settop(L, 0);
+    return true;
+}
+
 // -- driver.hpp implementation -----------------------------------------------
 int FuzzingAST::runLine(const ASTNode &node, AST &ast, BuiltinContext &ctx,
                         std::unique_ptr<ExecutionContext> &excCtx, bool echo) {
-    std::ostringstream script;
+    TraceScope trace;
+    static CodeBuffer script;
+    script.clear();
     nodeToLua(script, node, ast, ctx, 0);
     auto *L = reinterpret_cast<lua_State *>(excCtx->getContext());
-    auto ret = runLuaStr(L, script.str(), ast, ctx, echo, std::move(node));
+    auto ret = runLuaStr(L, script.str(), ast, ctx, echo, node,
+                         Latency::lineTimeoutMs(node));
     if (ret == -2)
         excCtx->releasePtr();
     return ret;
 }
 
+int FuzzingAST::runBatch(const std::vector<ASTNode> &nodes, AST &ast,
+                         BuiltinContext &ctx,
+                         std::unique_ptr<ExecutionContext> &excCtx,
+                         std::vector<LineResult> &results) {
+    results.assign(nodes.size(), {});
+    auto *L = reinterpret_cast<lua_State *>(excCtx->getContext());
+    // generate everything up front, only loading and calling run under the
+    // timer
+    std::vector<std::string> scripts(nodes.size());
+    {
+        static CodeBuffer script;
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            script.clear();
+            nodeToLua(script, nodes[i], ast, ctx, 0);
+            scripts[i] = script.str();
+        }
+    }
+    // error messages, repaired once the watchdog is disarmed
+    std::vector<std::string> errors(nodes.size());
+    std::vector<uint64_t> lineNs(nodes.size(), 0);
+    volatile size_t pos = 0;
+    volatile uint64_t lineStart = 0;
+    int batchRet = 0;
+    if (sigsetjmp(timeoutJmp, 1) == 0) {
+        Watchdog::arm(Latency::batchTimeoutMs(nodes));
+        while (pos < nodes.size()) {
+            resetTrace();
+            lineStart = Latency::nowNs();
+            int ret = luaL_loadstring(L, scripts[pos].c_str());
+            if (ret == LUA_OK)
+                ret = lua_pcall(L, 0, LUA_MULTRET, 0);
+            deferAlarm = 1;
+            lineNs[pos] = Latency::nowNs() - lineStart;
+            results[pos].newEdges = commitTrace();
+            newEdgeCnt += results[pos].newEdges;
+            const bool timedOut = Watchdog::softStruck();
+            if (ret != LUA_OK && !timedOut) {
+                results[pos].ret = -1;
+                if (lua_isstring(L, -1))
+                    errors[pos] = lua_tostring(L, -1);
+            }
+            lua_settop(L, 0);
+            // a timeout later in the batch rolls back to here
+            if (ret == LUA_OK)
+                excCtx->checkpoint();
+            deferAlarm = 0;
+            if (alarmPending) {
+                alarmPending = 0;
+                siglongjmp(timeoutJmp, 1);
+            }
+            if (timedOut)
+                break;
+            pos = pos + 1;
+        }
+        Watchdog::disarm();
+        if (pos < nodes.size()) {
+            for (size_t i = pos; i < nodes.size(); ++i)
+                results[i].ret = -3;
+            ERROR("Lua execution timed out");
+            batchRet = -3;
+        }
+    } else {
+        Watchdog::disarm();
+        deferAlarm = 0;
+        alarmPending = 0;
+        Latency::record(nodes[pos], Latency::nowNs() - lineStart, true);
+        for (size_t i = pos; i < nodes.size(); ++i)
+            results[i].ret = -2;
+        ERROR("Lua execution timed out");
+        excCtx->releasePtr();
+        return -2;
+    }
+    for (size_t i = 0; i < nodes.size() && i <= pos; ++i)
+        Latency::record(nodes[i], lineNs[i], results[i].ret == -3);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (results[i].ret == -1) {
+            ++errCnt;
+            errorCallback(errors[i], ast, ctx, nodes[i]);
+        }
+    }
+    return batchRet;
+}
+
 int FuzzingAST::runLines(const std::vector<ASTNode> &nodes, AST &ast,
                          BuiltinContext &ctx,
                          std::unique_ptr<ExecutionContext> &excCtx, bool echo) {
-    std::ostringstream script;
+    TraceScope trace;
+    static CodeBuffer script;
+    script.clear();
     for (auto nodeID : ast.scopes[0].declarations) {
         const auto &node = ast.declarations[nodeID];
         if (node.kind != ASTNodeKind::Function)
@@ -412,7 +586,9 @@ int FuzzingAST::runLines(const std::vector<ASTNode> &nodes, AST &ast,
 
 int FuzzingAST::runAST(AST &ast, BuiltinContext &ctx,
                        std::unique_ptr<ExecutionContext> &excCtx, bool echo) {
-    std::ostringstream script;
+    TraceScope trace;
+    static CodeBuffer script;
+    script.clear();
     scopeToLua(script, 0, ast, ctx, 0);
     auto *L = reinterpret_cast<lua_State *>(excCtx->getContext());
     auto ret = runLuaStr(L, script.str(), ast, ctx, echo);
@@ -424,13 +600,14 @@ int FuzzingAST::runAST(AST &ast, BuiltinContext &ctx,
 // -- reflectObject: run declarations, discover new types via Lua C API -------
 int FuzzingAST::reflectObject(AST &ast, ASTScope &scope, const ScopeID sid,
                               BuiltinContext &ctx) {
-    std::ostringstream script;
+    static CodeBuffer script;
+    script.clear();
     for (NodeID id : scope.declarations) {
         const auto &node = ast.declarations[id];
         if (node.kind != ASTNodeKind::Function)
             nodeToLua(script, node, ast, ctx, 0);
     }
-    std::string code = script.str();
+    const std::string &code = script.str();
     if (code.empty())
         return 0;
 
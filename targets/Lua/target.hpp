@@ -22,9 +22,15 @@ class LuaExecutionContext : public ExecutionContext {
 
     void *getContext() override { return state_.get(); }
     void releasePtr() override { (void)state_.release(); }
+    // shallow copy of _G kept in the registry, synced in place by each
+    // checkpoint. A table reached from _G isn't copied, fields the
+    // interrupted line set in it survive a restore
+    void checkpoint() override;
+    bool restore() override;
 
   private:
     LuaStatePtr state_;
+    int checkpointRef_ = LUA_NOREF;
 };
 
 } // namespace FuzzingAST
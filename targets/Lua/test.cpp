@@ -66,14 +66,14 @@ int main(int argc, char *argv[]) {
         for (const auto &declID : ast.scopes[0].declarations) {
             const auto &node = ast.declarations[declID];
             if (node.kind != ASTNodeKind::Function) {
-                std::ostringstream script;
+                CodeBuffer script;
                 nodeToLua(script, node, ast, ctx, 0);
                 std::cout << script.str();
                 result += script.str();
             }
         }
     } else {
-        std::ostringstream script;
+        CodeBuffer script;
         scopeToLua(script, 0, ast, ctx, 0);
         std::cout << "Generated Lua script:\n" << script.str() << "\n";
         result = script.str();